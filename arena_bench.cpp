@@ -0,0 +1,105 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Benchmark for allocating and destroying large trees. An input (e.g.,
+// one generated by gen_bench_input.rb) is parsed, and the time spent
+// parsing it and destroying the resulting tree (which is allocated in
+// the Context's NodeArena) is measured. For comparison, the tree is
+// then copied, both to the heap (one allocation per Node) and to
+// another NodeArena, and the time spent creating and destroying each
+// copy is measured.
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include "nearly_c.h"
+#include "node_arena.h"
+#include "flat_tree.h"
+
+namespace {
+
+// Number of times each operation is done (the fastest time is used)
+const unsigned NUM_RUNS = 3;
+
+// Time a function, returning the elapsed time in milliseconds
+double time_ms(const std::function<void()> &fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::milli> elapsed = end - start;
+  return elapsed.count();
+}
+
+// Record the fastest time for an operation
+void record(double &best, unsigned run, double ms) {
+  best = (run == 0) ? ms : std::min(best, ms);
+}
+
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: arena_bench <filename>\n");
+    exit(1);
+  }
+  const char *filename = argv[1];
+
+  double parse = 0, teardown = 0, heap_create = 0, heap_delete = 0, arena_create = 0, arena_clear = 0;
+  size_t num_nodes = 0, bytes = 0;
+  try {
+    Context ctx;
+    for (unsigned i = 0; i < NUM_RUNS; ++i) {
+      record(parse, i, time_ms([&]() { ctx.parse(filename); }));
+      num_nodes = ctx.get_arena().get_num_nodes();
+      bytes = ctx.get_arena().get_bytes_allocated();
+
+      // The copies are made from a FlatTree whose strings are in the
+      // global Interner (which the copies use), so that making them
+      // doesn't involve interning any strings
+      Node *global_root = FlatTree(ctx.get_ast()).to_node(nullptr);
+      FlatTree flat(global_root);
+      delete global_root;
+
+      Node *heap_root = nullptr;
+      record(heap_create, i, time_ms([&]() { heap_root = flat.to_node(nullptr); }));
+      record(heap_delete, i, time_ms([&]() { delete heap_root; }));
+
+      NodeArena arena;
+      record(arena_create, i, time_ms([&]() { flat.to_node(&arena); }));
+      record(arena_clear, i, time_ms([&]() { arena.clear(); }));
+
+      record(teardown, i, time_ms([&]() { ctx.clear_ast(); }));
+    }
+  } catch (BaseException &ex) {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    exit(1);
+  }
+
+  printf("%s: %zu nodes, %zu bytes in arena\n", filename, num_nodes, bytes);
+  printf("  parse:                  %10.1f ms\n", parse);
+  printf("  destroy tree:           %10.1f ms\n", teardown);
+  printf("  copy tree to heap:      %10.1f ms\n", heap_create);
+  printf("  delete heap copy:       %10.1f ms\n", heap_delete);
+  printf("  copy tree to arena:     %10.1f ms\n", arena_create);
+  printf("  clear arena:            %10.1f ms\n", arena_clear);
+  return 0;
+}
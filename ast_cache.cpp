@@ -0,0 +1,144 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "exceptions.h"
+#include "cpputil.h"
+#include "source_buffer.h"
+#include "tree_format.h"
+#include "grammar_hash.h"
+#include "ast_cache.h"
+
+// The Makefile defines these to identify the version of nearly_c
+// and the parser variant, since trees produced by a different
+// version or parser variant can't be used. Likewise, it generates
+// grammar_hash.h, which defines a checksum of the grammar and the
+// tag definitions, since changing the grammar can change the tags.
+#ifndef NEARLY_C_VERSION
+#  define NEARLY_C_VERSION "unknown"
+#endif
+#ifndef NEARLY_C_PARSER
+#  define NEARLY_C_PARSER "unknown"
+#endif
+
+namespace {
+
+// 64-bit FNV-1a hash
+uint64_t hash_bytes(const char *data, size_t size, uint64_t h = 14695981039346656037ULL) {
+  for (size_t i = 0; i < size; ++i) {
+    h = (h ^ uint64_t(static_cast<unsigned char>(data[i]))) * 1099511628211ULL;
+  }
+  return h;
+}
+
+}
+
+AstCache::AstCache(const std::string &dir)
+  : m_dir(dir)
+  , m_hits(0)
+  , m_misses(0)
+  , m_stores(0)
+  , m_load_us(0) {
+  if (mkdir(dir.c_str(), 0777) < 0 && errno != EEXIST) {
+    RuntimeError::raise("Couldn't create cache directory '%s': %s", dir.c_str(), strerror(errno));
+  }
+}
+
+AstCache::~AstCache() {
+}
+
+std::string AstCache::get_key(const char *text, size_t size) const {
+  // the version, parser variant, grammar checksum, and tree format
+  // version are hashed separately, so they can't run together with
+  // the text
+  static const char variant[] = NEARLY_C_VERSION "\n" NEARLY_C_PARSER "\n" NEARLY_C_GRAMMAR_HASH "\n";
+  uint64_t h = hash_bytes(variant, sizeof(variant) - 1);
+  h = hash_bytes(reinterpret_cast<const char *>(&TREE_FILE_VERSION), sizeof(TREE_FILE_VERSION), h);
+  uint64_t text_hash = hash_bytes(text, size);
+  return cpputil::format("%016llx%016llx-%zu", (unsigned long long) h, (unsigned long long) text_hash, size);
+}
+
+Node *AstCache::load(const std::string &key, NodeArena *arena, unsigned file_id) {
+  auto start = std::chrono::steady_clock::now();
+  Node *root = nullptr;
+
+  std::string path = get_path(key);
+  if (access(path.c_str(), R_OK) == 0) {
+    try {
+      SourceBuffer buf;
+      buf.load_file(path);
+      root = TreeReader::read(buf.get_data(), buf.get_size(), arena, file_id);
+    } catch (BaseException &) {
+      // treat as a miss (the tree will be stored again)
+      root = nullptr;
+    }
+  }
+
+  if (root == nullptr) {
+    ++m_misses;
+    return nullptr;
+  }
+
+  ++m_hits;
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  m_load_us += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  return root;
+}
+
+void AstCache::store(const std::string &key, Node *root) {
+  std::string data;
+  TreeWriter::write(root, data);
+
+  // write a temporary file (whose name is unique to this process
+  // and thread) and then rename it, so that other readers never
+  // see a partially-written file
+  std::string path = get_path(key);
+  std::string tmp_path = cpputil::format("%s.tmp.%ld.%zu", path.c_str(), long(getpid()),
+                                         std::hash<std::thread::id>()(std::this_thread::get_id()));
+  FILE *out = fopen(tmp_path.c_str(), "wb");
+  if (out == nullptr) {
+    return;
+  }
+  bool ok = fwrite(data.data(), 1, data.size(), out) == data.size();
+  ok = (fclose(out) == 0) && ok;
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+    return;
+  }
+  ++m_stores;
+}
+
+std::string AstCache::format_stats() const {
+  unsigned long hits = m_hits.load();
+  return cpputil::format("cache: %lu hits, %lu misses, %lu stores, %.3f ms loading (%.1f us/hit)\n",
+                         hits, m_misses.load(), m_stores.load(), m_load_us.load() / 1000.0,
+                         hits > 0 ? double(m_load_us.load()) / hits : 0.0);
+}
+
+std::string AstCache::get_path(const std::string &key) const {
+  return m_dir + "/" + key + ".nct";
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+
+#include <string>
+#include <atomic>
+#include <cstddef>
+class Node;
+class NodeArena;
+
+//! An AstCache is a directory of serialized trees (see tree_format.h),
+//! keyed by a hash of the source text, the parser variant (parse.y
+//! or parse_buildast.y), a checksum of the grammar and the tag
+//! definitions, and the version of nearly_c, so that
+//! unchanged source files don't need to be parsed again. Trees are
+//! written to the cache atomically (by writing a temporary file and
+//! renaming it), so several processes can share a cache directory.
+//! An AstCache may be used from multiple threads.
+class AstCache {
+private:
+  std::string m_dir;
+  std::atomic<unsigned long> m_hits;
+  std::atomic<unsigned long> m_misses;
+  std::atomic<unsigned long> m_stores;
+  std::atomic<unsigned long> m_load_us;
+
+  // copy ctor and assignment operator not allowed
+  AstCache(const AstCache &);
+  AstCache &operator=(const AstCache &);
+
+public:
+  //! Constructor. The directory is created if it doesn't exist.
+  //! Throws RuntimeError if it can't be created.
+  //! @param dir the cache directory
+  AstCache(const std::string &dir);
+
+  ~AstCache();
+
+  //! Compute the cache key for a source text.
+  //! @param text the source text
+  //! @param size the size of the source text
+  //! @return the cache key
+  std::string get_key(const char *text, size_t size) const;
+
+  //! Load a tree from the cache. Any error reading the cached
+  //! tree (e.g., if the file is corrupted) counts as a miss.
+  //! @param key the cache key
+  //! @param arena the arena in which to allocate the Nodes
+  //! @param file_id the source file id for the Nodes' Locations
+  //! @return the root of the tree, or null if it isn't in the cache
+  Node *load(const std::string &key, NodeArena *arena, unsigned file_id);
+
+  //! Store a tree in the cache. Errors are ignored (the tree
+  //! just won't be in the cache).
+  //! @param key the cache key
+  //! @param root the root of the tree
+  void store(const std::string &key, Node *root);
+
+  //! Format the cache statistics (hits, misses, stores,
+  //! and the total time spent loading trees) as text.
+  //! @return the formatted statistics
+  std::string format_stats() const;
+
+private:
+  std::string get_path(const std::string &key) const;
+};
+
+#endif // AST_CACHE_H
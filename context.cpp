@@ -18,99 +18,634 @@
 // ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
 // OTHER DEALINGS IN THE SOFTWARE.
 
-#include <set>
 #include <memory>
+#include <vector>
 #include <algorithm>
-#include <iterator>
+#include <atomic>
+#include <cstring>
 #include <cassert>
 #include "exceptions.h"
 #include "node.h"
+#include "ast.h"
 #include "parse.tab.h"
 #include "lex.yy.h"
 #include "parser_state.h"
+#include "token_pipeline.h"
+#include "source_buffer.h"
+#include "file_table.h"
+#include "thread_pool.h"
+#include "ast_cache.h"
+#include "parse_stats.h"
 #include "context.h"
 
 Context::Context()
-  : m_ast(nullptr) {
+  : m_ast(nullptr)
+  , m_file_id(0)
+  , m_pipelined(false)
+  , m_num_scan_threads(1)
+  , m_num_parse_threads(1)
+  , m_lazy_bodies(false)
+  , m_cache(nullptr)
+  , m_stats(nullptr) {
+  // the lexer state is reused for every input
+  yylex_init(&m_scan_info);
+
+  m_arena.set_interner(&m_interner);
+  m_stream_arena.set_interner(&m_stream_interner);
 }
 
 Context::~Context() {
-  delete m_ast;
+  // The AST's Nodes are allocated in m_arena (and, if the input was
+  // parsed in parallel, the worker arenas), which release them without
+  // visiting them individually. The arenas are cleared together,
+  // since Nodes in one arena can have children in another.
+  clear_arenas();
+
+  yylex_destroy(m_scan_info);
+
+  if (m_file_id != 0) {
+    FileTable::release_file(m_file_id);
+  }
 }
 
-struct CloseFile {
-  void operator()(FILE *in) {
-    if (in != nullptr) {
-      fclose(in);
+namespace {
+
+// Don't bother scanning chunks smaller than this in parallel
+const size_t MIN_SCAN_CHUNK_SIZE = 64 * 1024;
+
+// Don't bother parsing groups of top-level declarations with
+// fewer than this many tokens in parallel
+const unsigned MIN_PARSE_BATCH_TOKENS = 4096;
+
+// Tokens scanned from one chunk of the source text
+struct ScanChunk {
+  size_t start, end;
+  std::vector<char> text;
+  TokenTable tokens;
+  bool clean;
+};
+
+// Scan the source text by splitting it into chunks at newlines,
+// and scanning the chunks concurrently, each with its own scanner.
+// Tokens (other than whitespace) can only span a newline if they are
+// inside a block comment or a string literal. When a chunk boundary
+// falls inside one of these, the preceding chunk either ends in the
+// C_COMMENT start condition or fails with an error (because of the
+// unterminated string literal), and the chunk isn't "clean". The tokens
+// of clean chunks are appended to the token table (with their offsets
+// adjusted to be relative to the beginning of the source text.) If a
+// chunk isn't clean, everything from its beginning to the end of the
+// source text is scanned serially, so the resulting tokens (and errors)
+// are always exactly the same as if the entire source text had been
+// scanned serially. (Errors are recorded in pp->diagnostics.)
+void scan_tokens_parallel(SourceBuffer &src, ParserState *pp, unsigned num_threads) {
+  char *text = src.get_data();
+  size_t size = src.get_size();
+  TokenTable &tokens = *pp->tokens;
+
+  // split the source text into chunks at newlines
+  unsigned num_chunks = unsigned(std::min(size_t(num_threads), size / MIN_SCAN_CHUNK_SIZE));
+  std::vector<std::unique_ptr<ScanChunk>> chunks;
+  size_t start = 0;
+  for (unsigned i = 1; i <= num_chunks && start < size; ++i) {
+    size_t end = size;
+    if (i < num_chunks) {
+      size_t target = std::max(start, size_t(double(size) * i / num_chunks));
+      const char *nl = static_cast<const char *>(memchr(text + target, '\n', size - target));
+      end = (nl != nullptr) ? size_t(nl - text) + 1 : size;
     }
+    chunks.emplace_back(new ScanChunk);
+    chunks.back()->start = start;
+    chunks.back()->end = end;
+    start = end;
   }
-};
 
-namespace {
+  ThreadPool pool(num_threads);
+  pool.run(unsigned(chunks.size()), [&](unsigned, unsigned index) {
+    ScanChunk &chunk = *chunks[index];
+
+    // flex requires the buffer to end with two NUL characters,
+    // so the chunk is scanned from a copy of its text
+    size_t len = chunk.end - chunk.start;
+    chunk.text.resize(len + 2);
+    memcpy(chunk.text.data(), text + chunk.start, len);
+    chunk.tokens.reset(chunk.text.data(), tokens.get_file_id());
+    chunk.clean = false;
+
+    ParserState cs;
+    cs.tokens = &chunk.tokens;
+    yylex_init(&cs.scan_info);
+    yy_scan_buffer(chunk.text.data(), chunk.text.size(), cs.scan_info);
+    yyset_extra(&cs, cs.scan_info);
+    while (yylex(cs.scan_info) != 0)
+      ;
+    // an error might not be a real error: the chunk
+    // could end inside a string literal
+    chunk.clean = cs.diagnostics.empty() && lexer_in_initial_state(cs.scan_info);
+  });
+
+  for (auto i = chunks.begin(); i != chunks.end(); ++i) {
+    ScanChunk &chunk = **i;
+    if (!chunk.clean) {
+      // scan the rest of the source text serially
+      ParserState rest;
+      rest.tokens = &tokens;
+      rest.cur_loc = Location(tokens.get_file_id(), unsigned(chunk.start));
+      rest.diagnostics.set_limit(pp->diagnostics.get_limit());
+      yylex_init(&rest.scan_info);
+      yy_scan_buffer(text + chunk.start, src.get_scan_size() - chunk.start, rest.scan_info);
+      yyset_extra(&rest, rest.scan_info);
+      while (yylex(rest.scan_info) != 0)
+        ;
+      pp->diagnostics.merge(rest.diagnostics);
+      return;
+    }
+
+    for (unsigned j = 0; j < chunk.tokens.get_num_tokens(); ++j) {
+      const Token &tok = chunk.tokens.get_token(j);
+      tokens.add(tok.tag, unsigned(chunk.start) + tok.offset, tok.len);
+    }
+  }
+}
+
+// Scan the entire source text, using multiple threads if the
+// source text is large enough
+void scan_all_tokens(SourceBuffer &src, ParserState *pp, unsigned num_threads) {
+  if (num_threads > 1 && src.get_size() >= 2 * MIN_SCAN_CHUNK_SIZE) {
+    scan_tokens_parallel(src, pp, num_threads);
+    return;
+  }
+
+  // the lexer will add all of the tokens to the token table,
+  // so all we need to do is call yylex() until we reach the
+  // end of the input
+  while (yylex(pp->scan_info) != 0)
+    ;
+}
+
+// Find the end (i.e., the index of the token following the last token)
+// of each top-level declaration. Every top-level declaration ends with
+// either a semicolon or the right brace of a function body, outside of
+// any braces. A function body is recognized by the right parenthesis
+// (ending the parameter list) preceding its left brace; other braces
+// at the top level (e.g., of a struct type definition) are followed
+// by more of the declaration, so they don't end it. (If the input has
+// syntax errors, the ends found might not be correct, but that is
+// detected when the declarations are parsed.)
+std::vector<unsigned> find_top_level_ends(const TokenTable &tokens) {
+  std::vector<unsigned> ends;
+  unsigned num_tokens = tokens.get_num_tokens();
+  unsigned depth = 0;
+  bool function_body = false; // the outermost braces are a function body
+  for (unsigned i = 0; i < num_tokens; ++i) {
+    int tag = tokens.get_token(i).tag;
+    if (tag == TOK_LBRACE) {
+      if (depth++ == 0) {
+        function_body = (i > 0 && tokens.get_token(i - 1).tag == TOK_RPAREN);
+      }
+    } else if (tag == TOK_RBRACE) {
+      if (depth > 0 && --depth == 0 && function_body) {
+        ends.push_back(i + 1);
+      }
+    } else if (tag == TOK_SEMICOLON && depth == 0) {
+      ends.push_back(i + 1);
+    }
+  }
+  return ends;
+}
+
+// Lends a lexer state to a ParserState for as long as the ParserState
+// is in use (the ParserState's destructor would otherwise destroy it)
+struct LexerLoan {
+  ParserState &ps;
 
+  LexerLoan(ParserState &ps_, void *scan_info) : ps(ps_) { ps.scan_info = scan_info; }
+  ~LexerLoan() { ps.scan_info = nullptr; }
+};
+
+// Errors are recorded in diagnostics (which should be empty.)
+// If stats isn't null, the setup is timed, and the input is recorded.
 template<typename Fn>
-void process_source_file(const std::string &filename, Fn fn) {
-  // open the input source file
-  std::unique_ptr<FILE, CloseFile> in(fopen(filename.c_str(), "r"));
-  if (!in) {
-    RuntimeError::raise("Couldn't open '%s'", filename.c_str());
+void process_source(const std::string &name, SourceBuffer &src, unsigned &file_id, TokenTable &tokens,
+                    void *scan_info, Diagnostics &diagnostics, ParseStats *stats, Fn fn) {
+  ParseStats::PhaseTimer setup_timer(stats, ParseStats::PHASE_SETUP);
+
+  // Register the source text, so Locations can refer to it. The
+  // Context's entry in the FileTable is reused for each input, since
+  // the Locations referring to the previous input (i.e., in its tree)
+  // are no longer used.
+  if (file_id == 0) {
+    file_id = FileTable::add_file(name, src.get_data(), src.get_size());
+  } else {
+    FileTable::reset_file(file_id, name, src.get_data(), src.get_size());
   }
+  tokens.reset(src.get_data(), file_id);
 
-  // create an initialize ParserState; note that its destructor
-  // will take responsibility for cleaning up the lexer state
-  std::unique_ptr<ParserState> pp(new ParserState);
-  pp->cur_loc = Location(filename, 1, 1);
+  ParserState ps;
+  ps.cur_loc = Location(file_id, 0);
+  ps.tokens = &tokens;
+  ps.diagnostics.set_limit(diagnostics.get_limit());
 
-  // prepare the lexer
-  yylex_init(&pp->scan_info);
-  yyset_in(in.get(), pp->scan_info);
+  // prepare the lexer to scan the source buffer in place
+  LexerLoan loan(ps, scan_info);
+  lexer_start(scan_info, src.get_data(), src.get_scan_size());
 
   // make the ParserState available from the lexer state
-  yyset_extra(pp.get(), pp->scan_info);
+  yyset_extra(&ps, scan_info);
 
   // use the ParserState to either scan tokens or parse the input
-  // to build an AST
-  fn(pp.get());
+  // to build an AST (fn times its own phases)
+  fn(&ps);
+  diagnostics.merge(ps.diagnostics);
+  if (stats != nullptr) {
+    stats->record_input(tokens.get_num_tokens());
+  }
 }
 
 }
 
-void Context::scan_tokens(const std::string &filename, std::vector<Node *> &tokens) {
-  auto callback = [&](ParserState *pp) {
-    YYSTYPE yylval;
+void Context::scan_tokens(const std::string &filename) {
+  // read the input source file: the SourceBuffer will memory-map
+  // it if possible, so that the lexer can scan it in place
+  m_diagnostics.clear();
+  {
+    ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_SETUP);
+    m_source.load_file(filename);
+  }
+  scan_source(filename);
+}
 
-    // the lexer will store pointers to all of the allocated
-    // token objects in the ParserState, so all we need to do
-    // is call yylex() until we reach the end of the input
-    while (yylex(&yylval, pp->scan_info) != 0)
-      ;
+void Context::scan_tokens_string(std::string_view text, const std::string &name) {
+  m_diagnostics.clear();
+  {
+    ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_SETUP);
+    m_source.load_text(text);
+  }
+  scan_source(name);
+}
+
+void Context::parse(const std::string &filename) {
+  m_diagnostics.clear();
+  {
+    ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_SETUP);
+    m_source.load_file(filename);
+  }
+  parse_source(filename);
+}
+
+void Context::parse_string(std::string_view text, const std::string &name) {
+  m_diagnostics.clear();
+  {
+    ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_SETUP);
+    m_source.load_text(text);
+  }
+  parse_source(name);
+}
 
-    std::copy(pp->tokens.begin(), pp->tokens.end(), std::back_inserter(tokens));
+void Context::scan_source(const std::string &name) {
+  auto callback = [&](ParserState *pp) {
+    ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_LEX);
+    scan_all_tokens(m_source, pp, m_num_scan_threads);
   };
 
-  process_source_file(filename, callback);
+  process_source(name, m_source, m_file_id, m_tokens, m_scan_info, m_diagnostics, m_stats, callback);
+  m_diagnostics.raise_first();
 }
 
-void Context::parse(const std::string &filename) {
+void Context::parse_source(const std::string &name) {
+  // discard the previous AST (if any), keeping the arena's
+  // memory blocks to use for the new one
+  clear_ast();
+
   auto callback = [&](ParserState *pp) {
-    // parse the input source code
-    yyparse(pp);
+    // if the tree is in the cache, there's no need to parse the input
+    // (tokens aren't cached, so the token table will be empty)
+    std::string key;
+    if (m_cache != nullptr && !m_lazy_bodies) {
+      key = m_cache->get_key(m_source.get_data(), m_source.get_size());
+      m_ast = m_cache->load(key, &m_arena, pp->tokens->get_file_id());
+      if (m_ast != nullptr) {
+        return;
+      }
+    }
+
+    // parse the input source code, allocating Nodes in the arena
+    pp->arena = &m_arena;
+    pp->lazy_bodies = m_lazy_bodies;
+    {
+      ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_PARSE);
+      if (m_num_parse_threads > 1) {
+        parse_parallel(pp);
+      } else {
+        run_parser(pp);
+      }
+    }
 
-    // free memory allocated by flex
-    yylex_destroy(pp->scan_info);
+    if (m_stats != nullptr) {
+      record_allocation();
+      record_memory();
+    }
+    if (!pp->diagnostics.empty()) {
+      return;
+    }
 
     m_ast = pp->parse_tree;
+    for (auto i = pp->deferred_bodies.begin(); i != pp->deferred_bodies.end(); ++i) {
+      m_deferred_bodies[i->fn] = *i;
+    }
 
-    // delete any Nodes that were created by the lexer,
-    // but weren't incorporated into the parse tree
-    std::set<Node *> tree_nodes;
-    m_ast->preorder([&tree_nodes](Node *n) { tree_nodes.insert(n); });
-    for (auto i = pp->tokens.begin(); i != pp->tokens.end(); ++i) {
-      if (tree_nodes.count(*i) == 0) {
-        delete *i;
+    // delete any Nodes that were created by the parser,
+    // but weren't incorporated into the tree (e.g., because
+    // they were replaced using shift_kid()), if they own anything
+    // which wouldn't be released when the arenas are cleared
+    {
+      ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_CLEANUP);
+      m_arena.delete_unadopted(m_ast);
+      for (auto i = m_worker_arenas.begin(); i != m_worker_arenas.end(); ++i) {
+        (*i)->delete_unadopted(m_ast);
       }
     }
+
+    if (!key.empty()) {
+      m_cache->store(key, m_ast);
+    }
+  };
+
+  process_source(name, m_source, m_file_id, m_tokens, m_scan_info, m_diagnostics, m_stats, callback);
+  raise_errors();
+
+  if (m_stats != nullptr) {
+    m_stats->record_tree(m_ast);
+  }
+}
+
+void Context::parse_streaming(const std::string &filename, const std::function<void(Node *)> &fn) {
+  m_diagnostics.clear();
+  clear_ast();
+
+  // If statistics are being gathered, each declaration's Nodes
+  // are recorded before they are destroyed
+  std::function<void(Node *)> record_decl = [&](Node *decl) {
+    m_stats->record_allocation(m_stream_arena.get_num_nodes(), m_stream_arena.get_bytes_allocated());
+    m_stats->record_tree(decl, 1);
+    record_memory();
+    fn(decl);
   };
 
-  process_source_file(filename, callback);
+  auto callback = [&](ParserState *pp) {
+    // Each top-level declaration is allocated in m_stream_arena, which
+    // is cleared (along with its Interner, and the declaration's tokens)
+    // as soon as fn returns. The unit, and the placeholders for the
+    // declarations, are allocated in m_arena.
+    pp->arena = &m_stream_arena;
+    pp->unit_arena = &m_arena;
+    pp->decl_handler = (m_stats != nullptr) ? &record_decl : &fn;
+    ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_PARSE);
+    run_parser(pp);
+  };
+
+  {
+    ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_SETUP);
+    m_source.load_file(filename);
+  }
+  process_source(filename, m_source, m_file_id, m_tokens, m_scan_info, m_diagnostics, m_stats, callback);
+
+  // the unit only has placeholders, so it isn't useful
+  // (or recorded, other than the memory allocated for it)
+  if (m_stats != nullptr) {
+    m_stats->record_allocation(m_arena.get_num_nodes(), m_arena.get_bytes_allocated());
+    record_memory();
+  }
+  clear_arenas();
+  m_diagnostics.raise_first();
+}
+
+void Context::run_parser(ParserState *pp) {
+  if (m_pipelined) {
+    // if the lexer thread fails, the exception is rethrown
+    // here, rather than being thrown through the parser
+    std::exception_ptr error;
+    {
+      TokenPipeline pipeline(pp);
+      pp->pipeline = &pipeline;
+      yyparse(pp);
+      pp->pipeline = nullptr;
+      error = pipeline.get_error();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  } else {
+    yyparse(pp);
+  }
+}
+
+// Parse the input by scanning all of the tokens, splitting them into
+// batches of consecutive top-level declarations, and parsing each batch
+// with its own ParserState. The worker threads allocate Nodes in their
+// own arenas. If a batch has a syntax error, or the lexer reported an
+// error, the input is parsed again serially, so that the errors reported
+// are the same as if the input had been parsed serially.
+void Context::parse_parallel(ParserState *pp) {
+  {
+    ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_LEX);
+    scan_all_tokens(m_source, pp, m_num_scan_threads);
+  }
+
+  // The lexical errors are set aside while parsing (so that they
+  // don't count towards the error limit before the parser has read
+  // the tokens preceding them), and then merged with the syntax
+  // errors in source order
+  Diagnostics scan_errors;
+  scan_errors.set_limit(pp->diagnostics.get_limit());
+  scan_errors.merge(pp->diagnostics);
+  pp->diagnostics.clear();
+
+  TokenTable &tokens = *pp->tokens;
+  unsigned num_tokens = tokens.get_num_tokens();
+  Location start_loc(tokens.get_file_id(), 0);
+
+  // group the top-level declarations into batches
+  std::vector<std::pair<unsigned, unsigned>> batches;
+  if (scan_errors.empty()) {
+    std::vector<unsigned> ends = find_top_level_ends(tokens);
+    unsigned batch_size = std::max(MIN_PARSE_BATCH_TOKENS, num_tokens / (4 * m_num_parse_threads));
+    unsigned start = 0;
+    for (auto i = ends.begin(); i != ends.end(); ++i) {
+      if (*i - start >= batch_size) {
+        batches.push_back({ start, *i });
+        start = *i;
+      }
+    }
+    if (start < num_tokens) {
+      if (batches.empty()) {
+        batches.push_back({ start, num_tokens });
+      } else {
+        batches.back().second = num_tokens;
+      }
+    }
+  }
+
+  bool parsed = false;
+  if (batches.size() > 1) {
+    while (m_worker_arenas.size() + 1 < m_num_parse_threads) {
+      m_worker_arenas.emplace_back(new NodeArena);
+      m_worker_arenas.back()->set_interner(&m_interner);
+    }
+    std::vector<NodeArena *> arenas = { &m_arena };
+    for (auto i = m_worker_arenas.begin(); i != m_worker_arenas.end(); ++i) {
+      arenas.push_back(i->get());
+    }
+
+    std::vector<Node *> roots(batches.size());
+    std::vector<std::vector<DeferredBody>> deferred_bodies(batches.size());
+    std::atomic<bool> failed(false);
+    ThreadPool pool(m_num_parse_threads);
+    pool.run(unsigned(batches.size()), [&](unsigned worker, unsigned index) {
+      if (failed.load(std::memory_order_relaxed)) {
+        return;
+      }
+      ParserState bs;
+      bs.cur_loc = start_loc;
+      bs.tokens = &tokens;
+      bs.token_index = batches[index].first;
+      bs.token_end = batches[index].second;
+      bs.arena = arenas[worker];
+      bs.lazy_bodies = pp->lazy_bodies;
+      yyparse(&bs);
+      if (!bs.diagnostics.empty()) {
+        failed.store(true, std::memory_order_relaxed);
+        return;
+      }
+      roots[index] = bs.parse_tree;
+      deferred_bodies[index].swap(bs.deferred_bodies);
+    });
+
+    if (!failed.load()) {
+      // assemble the tree in source order
+      Node *root = roots[0];
+      if (root->get_tag() == AST_UNIT) {
+        // the AST_UNIT has the top-level declarations as its children
+        for (unsigned i = 1; i < roots.size(); ++i) {
+          root->append_kids_from(roots[i]);
+        }
+      } else {
+        // each unit has a top-level declaration and (optionally)
+        // a unit with the remaining declarations
+        for (unsigned i = 0; i + 1 < roots.size(); ++i) {
+          Node *last = roots[i];
+          while (last->get_num_kids() == 2) {
+            last = last->get_kid(1);
+          }
+          last->append_kid(roots[i + 1]);
+        }
+      }
+      pp->parse_tree = root;
+      for (auto i = deferred_bodies.begin(); i != deferred_bodies.end(); ++i) {
+        pp->deferred_bodies.insert(pp->deferred_bodies.end(), i->begin(), i->end());
+      }
+      parsed = true;
+    } else {
+      NodeArena::clear(arenas);
+    }
+  }
+
+  if (!parsed) {
+    pp->cur_loc = start_loc;
+    pp->token_index = 0;
+    pp->token_end = num_tokens;
+    pp->lexer_stopped = scan_errors.at_limit();
+    yyparse(pp);
+    pp->diagnostics.merge(scan_errors);
+  }
+}
+
+Node *Context::get_function_body(Node *fn) {
+  auto i = m_deferred_bodies.find(fn);
+  if (i == m_deferred_bodies.end()) {
+    return nullptr;
+  }
+  DeferredBody &deferred = i->second;
+  if (deferred.end == deferred.begin) {
+    // the body is either empty, or was already parsed
+    return deferred.body;
+  }
+
+  // Parse the body's tokens as a statement list. Note that the
+  // source text (which the lexemes refer to) is still available.
+  // Sweeping the whole arena for unadopted Nodes (including the
+  // placeholder) each time a body is parsed would be too expensive:
+  // they are simply destroyed when the arena is cleared.
+  ParserState ps;
+  ps.cur_loc = m_tokens.get_loc(deferred.begin);
+  ps.tokens = &m_tokens;
+  ps.token_index = deferred.begin;
+  ps.token_end = deferred.end;
+  ps.arena = &m_arena;
+  ps.start_token = TOK_FUNCTION_BODY;
+  ps.diagnostics.set_limit(m_diagnostics.get_limit());
+  {
+    ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_PARSE);
+    yyparse(&ps);
+  }
+  if (!ps.diagnostics.empty()) {
+    // the Nodes which were created are destroyed
+    // when the arena is cleared
+    m_diagnostics.clear();
+    m_diagnostics.merge(ps.diagnostics);
+    m_diagnostics.raise_first();
+  }
+
+  // replace the placeholder with the parsed body
+  for (unsigned j = 0; j < fn->get_num_kids(); ++j) {
+    if (fn->get_kid(j) == deferred.body) {
+      fn->set_kid(j, ps.parse_tree);
+      break;
+    }
+  }
+  deferred.body = ps.parse_tree;
+  deferred.begin = deferred.end;
+  return deferred.body;
+}
+
+// If errors were reported, discard the tree (which might be incomplete),
+// and throw a SyntaxError for the first error
+void Context::raise_errors() {
+  if (!m_diagnostics.empty()) {
+    clear_ast();
+    m_diagnostics.raise_first();
+  }
+}
+
+void Context::clear_ast() {
+  m_ast = nullptr;
+  m_deferred_bodies.clear();
+  clear_arenas();
+}
+
+void Context::clear_arenas() {
+  ParseStats::PhaseTimer timer(m_stats, ParseStats::PHASE_TEARDOWN);
+  std::vector<NodeArena *> arenas = { &m_arena, &m_stream_arena };
+  for (auto i = m_worker_arenas.begin(); i != m_worker_arenas.end(); ++i) {
+    arenas.push_back(i->get());
+  }
+  NodeArena::clear(arenas);
+
+  // no Nodes refer to the strings any more
+  m_interner.clear();
+  m_stream_interner.clear();
+}
+
+// Record the memory used for the current input's tokens and strings
+void Context::record_memory() {
+  m_stats->record_memory(m_tokens.get_memory_size(),
+                         m_interner.get_memory_size() + m_stream_interner.get_memory_size());
+}
+
+// Record the memory allocated in the arenas for the current input
+void Context::record_allocation() {
+  m_stats->record_allocation(m_arena.get_num_nodes(), m_arena.get_bytes_allocated());
+  for (auto i = m_worker_arenas.begin(); i != m_worker_arenas.end(); ++i) {
+    m_stats->record_allocation((*i)->get_num_nodes(), (*i)->get_bytes_allocated());
+  }
 }
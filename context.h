@@ -23,32 +23,172 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include "source_buffer.h"
+#include "token_table.h"
+#include "node_arena.h"
+#include "interner.h"
+#include "parser_state.h"
+#include "diagnostics.h"
 class Node;
+class AstCache;
+class ParseStats;
 
 // The Context class gathers together all of the objects/data
 // used in the compilation process, and orchestrates the various
 // passes and transformations.
+//
+// The Locations of an input's tokens, tree nodes, and errors refer
+// to the Context's entry in the FileTable (see file_table.h), which is
+// reused for the next input, and released when the Context is destroyed,
+// so they are only valid until then (like the tree itself.) Likewise,
+// the string values of the tree's Nodes are held by the Context's
+// Interner, which is cleared when the tree is discarded.
 class Context {
 private:
   Node *m_ast;
+  SourceBuffer m_source;
+  unsigned m_file_id; // the Context's entry in the FileTable
+  TokenTable m_tokens;
+  Interner m_interner; // strings of the tree's Nodes
+  Interner m_stream_interner; // strings of a declaration in streaming mode
+  NodeArena m_arena;
+  NodeArena m_stream_arena;
+  void *m_scan_info; // the lexer state (a yyscan_t)
+  std::vector<std::unique_ptr<NodeArena>> m_worker_arenas;
+  bool m_pipelined;
+  unsigned m_num_scan_threads;
+  unsigned m_num_parse_threads;
+  bool m_lazy_bodies;
+  AstCache *m_cache;
+  ParseStats *m_stats;
+  std::unordered_map<Node *, DeferredBody> m_deferred_bodies;
+  Diagnostics m_diagnostics;
 
   // copy ctor and assignment operator not allowed
   Context(const Context &);
   Context &operator=(const Context &);
 
+  void scan_source(const std::string &name);
+  void parse_source(const std::string &name);
+  void run_parser(ParserState *pp);
+  void parse_parallel(ParserState *pp);
+  void clear_arenas();
+  void raise_errors();
+  void record_allocation();
+  void record_memory();
+
 public:
   Context();
   ~Context();
 
-  // scan the input and store the resulting tokens in a vector
-  void scan_tokens(const std::string &filename, std::vector<Node *> &tokens);
+  // Scan the input and store the resulting tokens in the token table.
+  // If there are lexical errors, all of them (up to the error limit)
+  // are available from get_diagnostics(), and a SyntaxError is thrown
+  // for the first one. The same is true of syntax errors when parsing.
+  void scan_tokens(const std::string &filename);
+
+  // Like scan_tokens(), but the input is source text in memory
+  // (which is copied); name is used in error messages
+  void scan_tokens_string(std::string_view text, const std::string &name = "<input>");
 
-  // Parse an input file and build an AST
+  // Parse an input file and build an AST; the AST's Nodes are
+  // allocated in an arena owned by the Context, which destroys them
+  // all at once when the Context is destroyed or the next input is parsed
   void parse(const std::string &filename);
 
+  // Like parse(), but the input is source text in memory (which is
+  // copied); name is used in error messages. The Context's lexer state
+  // and memory are reused, so parsing many small inputs using the same
+  // Context is much cheaper than using a new Context for each one.
+  void parse_string(std::string_view text, const std::string &name = "<input>");
+
+  // Parse an input file in streaming mode: fn is called with each
+  // top-level declaration as soon as it has been parsed. The
+  // declaration's Nodes and strings, and its tokens, are discarded
+  // when fn returns, so only one declaration is in memory at a time
+  // (fn must not keep pointers to them). No AST (or token table) is
+  // available afterwards. Function bodies are always parsed, and the
+  // number of parse threads is ignored.
+  void parse_streaming(const std::string &filename, const std::function<void(Node *)> &fn);
+
+  // Enable or disable pipelined parsing: if enabled, parse() runs
+  // the lexer in a separate thread, which passes tokens to the parser
+  // through a lock-free queue (see TokenPipeline)
+  void set_pipelined(bool pipelined) { m_pipelined = pipelined; }
+
+  // Check whether pipelined parsing is enabled
+  bool is_pipelined() const { return m_pipelined; }
+
+  // Set the number of threads scan_tokens() uses: large inputs are
+  // split into chunks which are scanned concurrently (the resulting
+  // tokens are exactly the same as when scanning serially)
+  void set_num_scan_threads(unsigned num_threads) { m_num_scan_threads = num_threads; }
+
+  // Set the number of threads parse() uses: if greater than 1, the
+  // entire input is scanned first, and groups of top-level declarations
+  // are parsed concurrently (the resulting tree is exactly the same
+  // as when parsing serially); this takes precedence over pipelining
+  void set_num_parse_threads(unsigned num_threads) { m_num_parse_threads = num_threads; }
+
+  // Enable or disable lazy parsing of function bodies: if enabled,
+  // parse() skips the body of each function definition, which appears
+  // in the tree as an empty statement list until it is parsed
+  // by get_function_body()
+  void set_lazy_bodies(bool lazy) { m_lazy_bodies = lazy; }
+
+  // Set the cache of trees which parse() (and parse_string()) consult
+  // before parsing the input, and which they store the resulting trees
+  // in; the cache is owned by the caller, and may be shared by several
+  // Contexts. If null (the default), no cache is used. The cache isn't
+  // used when parsing function bodies lazily.
+  void set_cache(AstCache *cache) { m_cache = cache; }
+
+  // Set the object in which statistics about each input (the time
+  // spent in each phase, the numbers of tokens and Nodes, etc.) are
+  // accumulated; it is owned by the caller, and must not be destroyed
+  // before the Context (since the time spent destroying the tree is
+  // recorded.) If null (the default), no statistics are gathered.
+  void set_stats(ParseStats *stats) { m_stats = stats; }
+
+  // Get the object in which statistics are accumulated (may be null)
+  ParseStats *get_stats() const { return m_stats; }
+
+  // Set the maximum number of errors reported for each input: the lexer
+  // and parser recover from errors until this many have been reported.
+  // The default is 1, i.e., scanning and parsing stop at the first error.
+  void set_error_limit(unsigned limit) { m_diagnostics.set_limit(limit); }
+
+  // Get the errors reported for the most recent input
+  const Diagnostics &get_diagnostics() const { return m_diagnostics; }
+
+  // Get the body of a function definition (the statement list),
+  // parsing it first if its parsing was deferred; the body replaces
+  // the placeholder in the tree. Returns null if the Node isn't
+  // a function definition whose body was skipped by parse().
+  // Throws an exception if the body has a syntax error.
+  Node *get_function_body(Node *fn);
+
   // Get pointer to root of AST
   Node *get_ast() const { return m_ast; }
 
+  // Discard the AST (if any) and its strings, keeping the memory
+  // to use for the next input. (This happens anyway when the next
+  // input is parsed, or the Context is destroyed.)
+  void clear_ast();
+
+  // Get the arena in which the AST's Nodes are allocated
+  // (when parsing in parallel, the Nodes for most top-level
+  // declarations are allocated in other arenas)
+  const NodeArena &get_arena() const { return m_arena; }
+
+  // Get the table of tokens scanned from the input; the lexemes
+  // refer to the source text, which is owned by the Context
+  const TokenTable &get_tokens() const { return m_tokens; }
+
   // TODO: add member functions for semantic analysis, code generation, etc.
 };
 
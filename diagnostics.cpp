@@ -0,0 +1,57 @@
+// Copyright (c) 2021-2022, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include "exceptions.h"
+#include "diagnostics.h"
+
+Diagnostics::Diagnostics()
+  : m_limit(1)
+  , m_stopped(false) {
+}
+
+Diagnostics::~Diagnostics() {
+}
+
+void Diagnostics::add(const Location &loc, const std::string &msg) {
+  if (!at_limit()) {
+    m_errors.push_back({ loc, msg });
+  }
+}
+
+void Diagnostics::merge(const Diagnostics &other) {
+  m_errors.insert(m_errors.end(), other.m_errors.begin(), other.m_errors.end());
+  std::stable_sort(m_errors.begin(), m_errors.end(),
+    [](const Diagnostic &a, const Diagnostic &b) {
+      if (a.loc.get_file_id() != b.loc.get_file_id()) {
+        return a.loc.get_file_id() < b.loc.get_file_id();
+      }
+      return a.loc.get_offset() < b.loc.get_offset();
+    });
+  if (m_errors.size() > m_limit) {
+    m_errors.resize(m_limit);
+  }
+}
+
+void Diagnostics::raise_first() const {
+  if (!m_errors.empty()) {
+    throw SyntaxError(m_errors.front().loc, m_errors.front().msg);
+  }
+}
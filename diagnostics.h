@@ -0,0 +1,104 @@
+// Copyright (c) 2021-2022, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <vector>
+#include <string>
+#include "location.h"
+
+//! An error message and the source Location of the error.
+struct Diagnostic {
+  Location loc;
+  std::string msg;
+};
+
+//! Collects the errors reported by the lexer and parser, so that
+//! parsing can continue after an error (up to a limit), and all of
+//! the errors can be reported at once. Errors are reported by
+//! recording them rather than by throwing an exception, since an
+//! exception would have to pass through the code generated by flex
+//! and bison.
+class Diagnostics {
+private:
+  std::vector<Diagnostic> m_errors;
+  unsigned m_limit;
+  bool m_stopped;
+
+public:
+  //! Constructor. The limit is initially 1 error.
+  Diagnostics();
+  ~Diagnostics();
+
+  //! Set the maximum number of errors to record; when it is reached,
+  //! the lexer and parser stop.
+  //! @param limit the maximum number of errors (at least 1)
+  void set_limit(unsigned limit) { m_limit = (limit > 0) ? limit : 1; }
+
+  //! Get the maximum number of errors to record.
+  //! @return the maximum number of errors
+  unsigned get_limit() const { return m_limit; }
+
+  //! Record an error (which is ignored if the limit has been reached.)
+  //! @param loc the source Location of the error
+  //! @param msg the error message
+  void add(const Location &loc, const std::string &msg);
+
+  //! Add the errors recorded by another Diagnostics object. The errors
+  //! are put in source order, and only the first ones (up to the limit)
+  //! are kept.
+  //! @param other the other Diagnostics object
+  void merge(const Diagnostics &other);
+
+  //! Stop recording errors, as though the limit had been reached.
+  //! This is used when the lexer stopped at the limit before the end
+  //! of the input (in another thread, or before the parser started),
+  //! so that the parser doesn't report the premature end of the
+  //! input as a syntax error.
+  void stop() { m_stopped = true; }
+
+  //! Check whether the limit has been reached (or recording
+  //! errors was stopped.)
+  //! @return true if no more errors can be recorded
+  bool at_limit() const { return m_stopped || m_errors.size() >= m_limit; }
+
+  //! Check whether any errors were recorded.
+  //! @return true if there are no errors
+  bool empty() const { return m_errors.empty(); }
+
+  //! Get the number of errors recorded.
+  //! @return the number of errors
+  unsigned get_num_errors() const { return unsigned(m_errors.size()); }
+
+  //! Get an error.
+  //! @param index the index of the error (0 for the first one)
+  //! @return the error
+  const Diagnostic &get_error(unsigned index) const { return m_errors[index]; }
+
+  //! Discard all of the errors (and resume recording errors
+  //! if it was stopped.)
+  void clear() { m_errors.clear(); m_stopped = false; }
+
+  //! If any errors were recorded, throw a SyntaxError for the first one.
+  void raise_first() const;
+};
+
+#endif // DIAGNOSTICS_H
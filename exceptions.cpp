@@ -30,12 +30,18 @@
 
 BaseException::BaseException(const Location &loc, const std::string &desc)
   : std::runtime_error(desc)
-  , m_loc(loc) {
+  , m_loc(loc)
+  , m_srcfile(loc.get_srcfile())
+  , m_line(loc.get_line())
+  , m_col(loc.get_col()) {
 }
 
 BaseException::BaseException(const BaseException &other)
   : std::runtime_error(other)
-  , m_loc(other.m_loc) {
+  , m_loc(other.m_loc)
+  , m_srcfile(other.m_srcfile)
+  , m_line(other.m_line)
+  , m_col(other.m_col) {
 }
 
 BaseException::~BaseException() {
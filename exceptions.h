@@ -22,6 +22,7 @@
 #define EXCEPTIONS_H
 
 #include <stdexcept>
+#include <string>
 #include "location.h"
 
 //! @file
@@ -32,9 +33,18 @@
 
 //! Base type for exceptions indicating a syntax error,
 // a semantic error, or a general runtime error.
+//!
+//! The source file name, line number, and column number of the
+//! exception's Location are looked up when the exception is created,
+//! since an exception can outlive the source text (and the FileTable
+//! entry) its Location refers to, e.g., if it is caught after the
+//! Context which parsed the source file is destroyed.
 class BaseException : public std::runtime_error {
 private:
   Location m_loc;
+  std::string m_srcfile;
+  int m_line;
+  int m_col;
 
 public:
   //! Constructor.
@@ -53,9 +63,29 @@ public:
   //!         false otherwise
   bool has_location() const { return m_loc.is_valid(); }
 
-  //! Get the source Location.
+  //! Get the source Location. Note that the Location only refers
+  //! to the source file for as long as the source file's entry in
+  //! the FileTable is in use (see get_srcfile(), get_line(), and
+  //! get_col(), which don't have this restriction.)
   //! @return the source Location
   const Location &get_loc() const;
+
+  //! Get the name of the source file in which the error occurred.
+  //! @return the source file name ("<unknown>" if the exception
+  //!         doesn't have a valid source Location)
+  const std::string &get_srcfile() const { return m_srcfile; }
+
+  //! Get the line number (1 for the first line) at which the
+  //! error occurred.
+  //! @return the line number (-1 if the exception doesn't have a
+  //!         valid source Location)
+  int get_line() const { return m_line; }
+
+  //! Get the column number (1 for the first column) at which the
+  //! error occurred.
+  //! @return the column number (-1 if the exception doesn't have a
+  //!         valid source Location)
+  int get_col() const { return m_col; }
 };
 
 #ifdef __GNUC__
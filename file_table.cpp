@@ -0,0 +1,154 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstring>
+#include <mutex>
+#include <algorithm>
+#include <cassert>
+#include "exceptions.h"
+#include "file_table.h"
+
+////////////////////////////////////////////////////////////////////////
+// SourceFile member functions
+////////////////////////////////////////////////////////////////////////
+
+SourceFile::SourceFile(const std::string &name, const char *text, size_t size)
+  : m_name(name)
+  , m_text(text)
+  , m_size(size)
+  , m_indexed(false) {
+}
+
+SourceFile::~SourceFile() {
+}
+
+void SourceFile::reset(const std::string &name, const char *text, size_t size) {
+  m_name = name;
+  m_text = text;
+  m_size = size;
+  m_line_starts.clear();
+  m_indexed.store(false, std::memory_order_release);
+}
+
+int SourceFile::get_line(unsigned offset) const {
+  build_index();
+
+  // find the first line starting after the offset:
+  // the line before it is the one containing the offset
+  auto i = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), offset);
+  return int(i - m_line_starts.begin());
+}
+
+int SourceFile::get_col(unsigned offset) const {
+  unsigned line_start = m_line_starts[get_line(offset) - 1];
+  return int(offset - line_start) + 1;
+}
+
+// Find the beginning of each line. Several threads could request
+// line numbers at the same time, so the index is built while holding
+// a lock, and is published by setting m_indexed.
+void SourceFile::build_index_slow() const {
+  std::lock_guard<std::mutex> guard(m_index_lock);
+  if (m_indexed.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  m_line_starts.push_back(0);
+  const char *end = m_text + m_size;
+  for (const char *p = m_text; ; ) {
+    p = static_cast<const char *>(memchr(p, '\n', size_t(end - p)));
+    if (p == nullptr) {
+      break;
+    }
+    ++p;
+    m_line_starts.push_back(unsigned(p - m_text));
+  }
+
+  m_indexed.store(true, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////
+// FileTable member functions
+////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// The entries are stored in segments which are allocated as needed
+// and never moved or freed, so an entry can be looked up without
+// a lock (the segment pointers and entries are atomic, so an entry
+// is visible to any thread which has been given its id)
+const unsigned SEGMENT_SIZE = 256;
+const unsigned MAX_SEGMENTS = 4096;
+
+std::atomic<std::atomic<SourceFile *> *> s_segments[MAX_SEGMENTS];
+
+// Protects s_num_ids and s_free_ids
+std::mutex s_file_table_lock;
+
+// Id 0 is used for invalid Locations, so it is never assigned
+unsigned s_num_ids = 1;
+
+// Released ids (whose SourceFile objects are kept for reuse)
+std::vector<unsigned> s_free_ids;
+
+std::atomic<SourceFile *> &get_entry(unsigned id) {
+  std::atomic<SourceFile *> *segment = s_segments[id / SEGMENT_SIZE].load(std::memory_order_acquire);
+  return segment[id % SEGMENT_SIZE];
+}
+
+}
+
+unsigned FileTable::add_file(const std::string &name, const char *text, size_t size) {
+  std::lock_guard<std::mutex> guard(s_file_table_lock);
+
+  if (!s_free_ids.empty()) {
+    unsigned id = s_free_ids.back();
+    s_free_ids.pop_back();
+    get_entry(id).load(std::memory_order_relaxed)->reset(name, text, size);
+    return id;
+  }
+
+  unsigned id = s_num_ids;
+  unsigned seg_index = id / SEGMENT_SIZE;
+  if (seg_index >= MAX_SEGMENTS) {
+    RuntimeError::raise("Too many source files");
+  }
+  if (s_segments[seg_index].load(std::memory_order_relaxed) == nullptr) {
+    s_segments[seg_index].store(new std::atomic<SourceFile *>[SEGMENT_SIZE](), std::memory_order_release);
+  }
+  get_entry(id).store(new SourceFile(name, text, size), std::memory_order_release);
+  ++s_num_ids;
+  return id;
+}
+
+void FileTable::reset_file(unsigned id, const std::string &name, const char *text, size_t size) {
+  get_entry(id).load(std::memory_order_acquire)->reset(name, text, size);
+}
+
+void FileTable::release_file(unsigned id) {
+  std::lock_guard<std::mutex> guard(s_file_table_lock);
+  assert(id > 0 && id < s_num_ids);
+  s_free_ids.push_back(id);
+}
+
+const SourceFile *FileTable::get_file(unsigned id) {
+  assert(id > 0 && id < MAX_SEGMENTS * SEGMENT_SIZE);
+  return get_entry(id).load(std::memory_order_acquire);
+}
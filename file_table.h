@@ -0,0 +1,142 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef FILE_TABLE_H
+#define FILE_TABLE_H
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <cstddef>
+
+//! A SourceFile records the name and text of a source file, and the
+//! offsets at which its lines begin, so that the line and column numbers
+//! of a source Location (which is just a byte offset) can be computed
+//! when they are needed. The index of line beginnings is built the
+//! first time a line or column number is requested, so the source text
+//! must remain valid until then (in practice, for as long as the
+//! SourceFile is in use.)
+class SourceFile {
+private:
+  std::string m_name;
+  const char *m_text;
+  size_t m_size;
+  mutable std::vector<unsigned> m_line_starts;
+  mutable std::atomic<bool> m_indexed;
+  mutable std::mutex m_index_lock;
+
+  // copy ctor and assignment operator not allowed
+  SourceFile(const SourceFile &);
+  SourceFile &operator=(const SourceFile &);
+
+public:
+  //! Constructor.
+  //! @param name the name of the source file
+  //! @param text the source text
+  //! @param size the size of the source text
+  SourceFile(const std::string &name, const char *text, size_t size);
+
+  ~SourceFile();
+
+  //! Replace the name and text (discarding the index of line
+  //! beginnings), so that the SourceFile can be reused for another
+  //! input. This must not be called while the SourceFile is in use
+  //! by another thread.
+  //! @param name the name of the source file
+  //! @param text the source text
+  //! @param size the size of the source text
+  void reset(const std::string &name, const char *text, size_t size);
+
+  //! Get the source file name.
+  //! @return the source file name
+  const std::string &get_name() const { return m_name; }
+
+  //! Get the number of lines in the source file.
+  //! @return the number of lines
+  unsigned get_num_lines() const { build_index(); return unsigned(m_line_starts.size()); }
+
+  //! Get the byte offsets at which the lines begin (the first is 0.)
+  //! @return the offsets of the line beginnings, in increasing order
+  const std::vector<unsigned> &get_line_starts() const { build_index(); return m_line_starts; }
+
+  //! Get the line number (1 for the first line) of a byte offset.
+  //! @param offset the byte offset
+  //! @return the line number
+  int get_line(unsigned offset) const;
+
+  //! Get the column number (1 for the first column) of a byte offset.
+  //! @param offset the byte offset
+  //! @return the column number
+  int get_col(unsigned offset) const;
+
+private:
+  void build_index() const {
+    if (!m_indexed.load(std::memory_order_acquire)) {
+      build_index_slow();
+    }
+  }
+  void build_index_slow() const;
+};
+
+//! The FileTable is a global table of SourceFiles, so that a source
+//! Location can refer to its source file using a small integer id.
+//! A source file's entry can be released when the Locations referring
+//! to it are no longer needed, so that its id (and SourceFile object)
+//! can be reused; e.g., each Context has one entry, which it reuses
+//! for each input. Entries which are never released remain valid for
+//! the lifetime of the program. Pointers to SourceFile objects remain
+//! valid (although a released entry's SourceFile may be reused.)
+//!
+//! The FileTable may be used from multiple threads. Adding and releasing
+//! entries takes a lock, but looking up an entry (which is done for
+//! every line or column number) doesn't.
+class FileTable {
+public:
+  //! Add a source file to the table. The source text must remain
+  //! valid until the entry is released (see SourceFile.)
+  //! Throws RuntimeError if there are too many entries.
+  //! @param name the name of the source file
+  //! @param text the source text
+  //! @param size the size of the source text
+  //! @return the source file's id (always greater than 0)
+  static unsigned add_file(const std::string &name, const char *text, size_t size);
+
+  //! Reuse an entry for another source file: Locations referring to the
+  //! id will refer to the new source file. This must not be called while
+  //! the entry is in use by another thread.
+  //! @param id a source file id returned by `add_file`
+  //! @param name the name of the source file
+  //! @param text the source text
+  //! @param size the size of the source text
+  static void reset_file(unsigned id, const std::string &name, const char *text, size_t size);
+
+  //! Release an entry, so that its id can be reused by `add_file`.
+  //! Locations referring to the id must no longer be used.
+  //! @param id a source file id returned by `add_file`
+  static void release_file(unsigned id);
+
+  //! Get the SourceFile with given id.
+  //! @param id a source file id returned by `add_file`
+  //! @return pointer to the SourceFile
+  static const SourceFile *get_file(unsigned id);
+};
+
+#endif // FILE_TABLE_H
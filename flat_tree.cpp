@@ -0,0 +1,105 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "node.h"
+#include "flat_tree.h"
+
+FlatTree::FlatTree(Node *root)
+  : m_interner(&root->get_interner()) {
+  // indices of the nodes which have been entered but not left
+  std::vector<unsigned> stack;
+
+  root->traverse(
+    [&](Node *n, unsigned) {
+      unsigned parent = stack.empty() ? NONE : stack.back();
+      stack.push_back(unsigned(m_tags.size()));
+      m_tags.push_back(n->get_tag());
+      m_syms.push_back(n->get_sym());
+      m_locs.push_back(n->get_loc());
+      m_locs_explicit.push_back(n->is_loc_set_explicitly());
+      m_parents.push_back(parent);
+      m_subtree_ends.push_back(0); // set when the node is left
+      m_num_kids.push_back(n->get_num_kids());
+      return TRAVERSE_CONTINUE;
+    },
+    [&](Node *, unsigned) {
+      m_subtree_ends[stack.back()] = unsigned(m_tags.size());
+      stack.pop_back();
+      return TRAVERSE_CONTINUE;
+    });
+}
+
+FlatTree::~FlatTree() {
+}
+
+Node *FlatTree::to_node(NodeArena *arena) const {
+  std::vector<Node *> nodes(m_tags.size());
+
+  // Nodes are created in preorder, so each node's parent
+  // has already been created when the node is created
+  for (unsigned i = 0; i < get_num_nodes(); ++i) {
+    Node *n = new (arena) Node(m_tags[i]);
+    Interner &interner = n->get_interner();
+    n->set_sym((&interner == m_interner) ? m_syms[i] : interner.intern(m_interner->get(m_syms[i])));
+    if (m_parents[i] != NONE) {
+      nodes[m_parents[i]]->append_kid(n);
+    }
+    nodes[i] = n;
+  }
+
+  // Appending a child can give a Node without a Location the child's
+  // Location, so each Node's Location (or its absence), and whether
+  // it was set explicitly, are restored once the tree is complete
+  for (unsigned i = 0; i < get_num_nodes(); ++i) {
+    nodes[i]->restore_loc(m_locs[i], m_locs_explicit[i]);
+  }
+
+  return nodes.empty() ? nullptr : nodes[0];
+}
+
+size_t FlatTree::get_memory_size() const {
+  return m_tags.capacity() * sizeof(int)
+    + m_syms.capacity() * sizeof(unsigned)
+    + m_locs.capacity() * sizeof(Location)
+    + m_locs_explicit.capacity() / 8
+    + m_parents.capacity() * sizeof(unsigned)
+    + m_subtree_ends.capacity() * sizeof(unsigned)
+    + m_num_kids.capacity() * sizeof(unsigned);
+}
+
+unsigned FlatTree::count_tag(int tag) const {
+  unsigned count = 0;
+  for (auto i = m_tags.begin(); i != m_tags.end(); ++i) {
+    if (*i == tag) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+std::vector<unsigned> FlatTree::find_tag(int tag) const {
+  std::vector<unsigned> result;
+  for (unsigned i = 0; i < get_num_nodes(); ++i) {
+    if (m_tags[i] == tag) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,226 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef FLAT_TREE_H
+#define FLAT_TREE_H
+
+#include <vector>
+#include <string_view>
+#include "location.h"
+#include "interner.h"
+#include "node.h"
+class NodeArena;
+
+//! An immutable tree stored as parallel arrays ("structure of arrays")
+//! with the nodes laid out in preorder. Nodes are identified by their
+//! index: the root is node 0, the first child of a node (if it has any
+//! children) immediately follows it, and the subtree rooted at node `i`
+//! consists of the nodes from `i` up to (but not including)
+//! `get_subtree_end(i)`.
+//!
+//! Analyses which need to look at every node (e.g., counting nodes
+//! with a particular tag) can just loop over the indices from 0 to
+//! `get_num_nodes()`, which is much more cache-friendly than
+//! traversing a tree of Nodes.
+class FlatTree {
+private:
+  std::vector<int> m_tags;
+  std::vector<unsigned> m_syms;
+  std::vector<Location> m_locs;
+  std::vector<bool> m_locs_explicit;
+  std::vector<unsigned> m_parents;
+  std::vector<unsigned> m_subtree_ends;
+  std::vector<unsigned> m_num_kids;
+  Interner *m_interner; // holds the nodes' string values
+
+  // copy ctor and assignment operator not allowed
+  FlatTree(const FlatTree &);
+  FlatTree &operator=(const FlatTree &);
+
+public:
+  //! Parent index of the root node.
+  static constexpr unsigned NONE = ~0U;
+
+  //! Constructor. Builds a FlatTree from a tree of Nodes. The FlatTree
+  //! refers to the string values in the Interner used by the root (see
+  //! Node::get_interner()), so it must not be used after the Interner
+  //! is cleared.
+  //! @param root the root of the tree of Nodes
+  FlatTree(Node *root);
+
+  ~FlatTree();
+
+  //! Convert to a tree of Nodes.
+  //! @param arena the NodeArena to allocate the Nodes in
+  //!              (if null, the Nodes are allocated on the heap)
+  //! @return the root of the tree of Nodes
+  Node *to_node(NodeArena *arena) const;
+
+  //! Get the number of nodes in the tree.
+  //! @return the number of nodes
+  unsigned get_num_nodes() const { return unsigned(m_tags.size()); }
+
+  //! Get a node's tag.
+  //! @param i index of a node
+  //! @return the node's tag
+  int get_tag(unsigned i) const { return m_tags[i]; }
+
+  //! Get the symbol id of a node's string value (see Interner).
+  //! The symbol id belongs to the Interner used by the root
+  //! of the tree of Nodes the FlatTree was built from.
+  //! @param i index of a node
+  //! @return the symbol id of the node's string value
+  unsigned get_sym(unsigned i) const { return m_syms[i]; }
+
+  //! Get a node's string value.
+  //! @param i index of a node
+  //! @return view of the node's string value
+  std::string_view get_str_view(unsigned i) const { return m_interner->get(m_syms[i]); }
+
+  //! Get a node's source Location.
+  //! @param i index of a node
+  //! @return the node's source Location
+  const Location &get_loc(unsigned i) const { return m_locs[i]; }
+
+  //! Check whether a node's source Location was set explicitly
+  //! (see Node::is_loc_set_explicitly()).
+  //! @param i index of a node
+  //! @return true if the node's source Location was set explicitly
+  bool is_loc_explicit(unsigned i) const { return m_locs_explicit[i]; }
+
+  //! Get the index of a node's parent.
+  //! @param i index of a node
+  //! @return the index of the node's parent, or NONE for the root
+  unsigned get_parent(unsigned i) const { return m_parents[i]; }
+
+  //! Get the index one past the last node in a node's subtree.
+  //! @param i index of a node
+  //! @return the index one past the last node in the subtree
+  unsigned get_subtree_end(unsigned i) const { return m_subtree_ends[i]; }
+
+  //! Get the number of children of a node.
+  //! @param i index of a node
+  //! @return the number of children
+  unsigned get_num_kids(unsigned i) const { return m_num_kids[i]; }
+
+  //! Get the index of a node's first child.
+  //! @param i index of a node
+  //! @return the index of the first child, or NONE if the node
+  //!         has no children
+  unsigned get_first_kid(unsigned i) const { return m_num_kids[i] > 0 ? i + 1 : NONE; }
+
+  //! Get the index of a node's next sibling.
+  //! @param i index of a node
+  //! @return the index of the next sibling, or NONE if the node
+  //!         is the last child of its parent (or is the root)
+  unsigned get_next_sibling(unsigned i) const {
+    unsigned next = m_subtree_ends[i];
+    return (m_parents[i] != NONE && next < m_subtree_ends[m_parents[i]]) ? next : NONE;
+  }
+
+  //! Invoke a function on the index of each child of a node.
+  //! @tparam Fn function type
+  //! @param i index of the parent node
+  //! @param fn the function to apply to each child's index
+  template<typename Fn>
+  void each_kid(unsigned i, Fn fn) const {
+    unsigned end = m_subtree_ends[i];
+    for (unsigned k = i + 1; k < end; k = m_subtree_ends[k]) {
+      fn(k);
+    }
+  }
+
+  //! Get the amount of memory used by the FlatTree's arrays.
+  //! @return the number of bytes used
+  size_t get_memory_size() const;
+
+  //! Count the nodes with a specified tag.
+  //! @param tag the tag
+  //! @return the number of nodes with the tag
+  unsigned count_tag(int tag) const;
+
+  //! Find all of the nodes with a specified tag.
+  //! @param tag the tag
+  //! @return vector containing the indices of the nodes with the tag,
+  //!         in preorder
+  std::vector<unsigned> find_tag(int tag) const;
+
+  //! Traverse the subtree rooted at a node, invoking callbacks
+  //! when each node is entered and left, in the same way as
+  //! Node::traverse(). The callbacks are called as `fn(i, depth)`,
+  //! where `i` is the index of the node, and return a TraversalAction.
+  //! @tparam Enter type of the function called when a node is entered
+  //! @tparam Leave type of the function called when a node is left
+  //! @param root index of the root of the subtree to traverse
+  //! @param enter function called when a node is entered
+  //! @param leave function called when a node is left
+  //! @return true if the traversal completed, false if it
+  //!         was stopped by a callback returning TRAVERSE_STOP
+  template<typename Enter, typename Leave>
+  bool traverse(unsigned root, Enter enter, Leave leave) const;
+};
+
+template<typename Enter, typename Leave>
+bool FlatTree::traverse(unsigned root, Enter enter, Leave leave) const {
+  // Because the nodes are in preorder, the traversal is just a
+  // scan over the nodes in the subtree; the stack keeps track of
+  // the nodes which have been entered but not left
+  std::vector<unsigned> stack;
+
+  unsigned end = m_subtree_ends[root];
+  unsigned i = root;
+  while (i < end) {
+    // leave the nodes whose subtrees end here
+    while (!stack.empty() && m_subtree_ends[stack.back()] <= i) {
+      unsigned done = stack.back();
+      stack.pop_back();
+      if (leave(done, unsigned(stack.size())) == TRAVERSE_STOP) {
+        return false;
+      }
+    }
+
+    unsigned depth = unsigned(stack.size());
+    TraversalAction action = enter(i, depth);
+    if (action == TRAVERSE_STOP) {
+      return false;
+    }
+    if (action == TRAVERSE_CONTINUE && m_num_kids[i] > 0) {
+      stack.push_back(i);
+      ++i;
+    } else {
+      if (leave(i, depth) == TRAVERSE_STOP) {
+        return false;
+      }
+      i = m_subtree_ends[i];
+    }
+  }
+
+  while (!stack.empty()) {
+    unsigned done = stack.back();
+    stack.pop_back();
+    if (leave(done, unsigned(stack.size())) == TRAVERSE_STOP) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#endif // FLAT_TREE_H
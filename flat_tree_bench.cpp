@@ -0,0 +1,140 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Benchmark comparing a tree of Nodes with the equivalent FlatTree.
+// An input (e.g., one generated by gen_bench_input.rb) is parsed, and
+// the memory used by the tree of Nodes (the bytes allocated for a copy
+// of it in a NodeArena) and by a FlatTree built from it is reported,
+// along with the time spent building the FlatTree. Then the time spent
+// counting the identifiers in the tree, and doing a complete traversal
+// of it, is measured for both representations.
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include "nearly_c.h"
+#include "node_arena.h"
+#include "grammar_symbols.h"
+#include "flat_tree.h"
+
+namespace {
+
+// Number of times each operation is done (the fastest time is used)
+const unsigned NUM_RUNS = 5;
+
+// Time a function, returning the elapsed time in milliseconds
+double time_ms(const std::function<void()> &fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::milli> elapsed = end - start;
+  return elapsed.count();
+}
+
+// Record the fastest time for an operation
+void record(double &best, unsigned run, double ms) {
+  best = (run == 0) ? ms : std::min(best, ms);
+}
+
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: flat_tree_bench <filename>\n");
+    exit(1);
+  }
+  const char *filename = argv[1];
+
+  double build = 0, node_count = 0, flat_count = 0, node_traverse = 0, flat_traverse = 0;
+  size_t num_nodes = 0, node_bytes = 0, flat_bytes = 0;
+  unsigned long num_idents = 0, depth_sum = 0;
+  try {
+    Context ctx;
+    ctx.parse(filename);
+    Node *root = ctx.get_ast();
+
+    for (unsigned i = 0; i < NUM_RUNS; ++i) {
+      record(build, i, time_ms([&]() { FlatTree flat(root); }));
+    }
+    FlatTree flat(root);
+    num_nodes = flat.get_num_nodes();
+    flat_bytes = flat.get_memory_size();
+
+    // The arena used for parsing also has the Nodes discarded
+    // by the parser, so the tree is copied to measure its size
+    NodeArena arena;
+    flat.to_node(&arena);
+    node_bytes = arena.get_bytes_allocated();
+    arena.clear();
+
+    for (unsigned i = 0; i < NUM_RUNS; ++i) {
+      unsigned long n_count = 0, f_count = 0;
+      record(node_count, i, time_ms([&]() {
+        root->preorder([&](Node *n) {
+          if (n->get_tag() == NODE_TOK_IDENT) {
+            ++n_count;
+          }
+        });
+      }));
+      record(flat_count, i, time_ms([&]() { f_count = flat.count_tag(NODE_TOK_IDENT); }));
+      if (n_count != f_count) {
+        fprintf(stderr, "Error: counts differ (%lu vs %lu)\n", n_count, f_count);
+        exit(1);
+      }
+      num_idents = f_count;
+
+      // A complete traversal (summing the depths of the nodes,
+      // so that it isn't optimized away)
+      unsigned long n_sum = 0, f_sum = 0;
+      record(node_traverse, i, time_ms([&]() {
+        root->traverse(
+          [&](Node *, unsigned depth) { n_sum += depth; return TRAVERSE_CONTINUE; },
+          [](Node *, unsigned) { return TRAVERSE_CONTINUE; });
+      }));
+      record(flat_traverse, i, time_ms([&]() {
+        flat.traverse(0,
+          [&](unsigned, unsigned depth) { f_sum += depth; return TRAVERSE_CONTINUE; },
+          [](unsigned, unsigned) { return TRAVERSE_CONTINUE; });
+      }));
+      if (n_sum != f_sum) {
+        fprintf(stderr, "Error: traversals differ\n");
+        exit(1);
+      }
+      depth_sum = f_sum;
+    }
+  } catch (BaseException &ex) {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    exit(1);
+  }
+
+  printf("%s: %zu nodes, %lu identifiers, depth sum %lu\n", filename, num_nodes, num_idents, depth_sum);
+  printf("  Node tree memory:       %10zu bytes (%.1f per node)\n", node_bytes, double(node_bytes) / num_nodes);
+  printf("  FlatTree memory:        %10zu bytes (%.1f per node)\n", flat_bytes, double(flat_bytes) / num_nodes);
+  printf("  build FlatTree:         %10.1f ms\n", build);
+  printf("  count identifiers:\n");
+  printf("    Node tree:            %10.1f ms\n", node_count);
+  printf("    FlatTree:             %10.1f ms\n", flat_count);
+  printf("  traverse:\n");
+  printf("    Node tree:            %10.1f ms\n", node_traverse);
+  printf("    FlatTree:             %10.1f ms\n", flat_traverse);
+  return 0;
+}
@@ -40,7 +40,19 @@ def gen_ast_visitor_h(outf, ast_tags)
 class Node;
 
 //! Base class for AST visitors.
+//!
+//! The children of a Node are visited using an explicit stack
+//! (see Node::traverse) rather than recursion, so the depth of the
+//! tree is limited only by available memory. When a visitation member
+//! function calls `visit_children` on the Node being visited, the
+//! children are therefore visited *after* the member function returns.
+//! A subclass which needs to do something once a Node's children have
+//! been visited should override `leave`.
 class ASTVisitor {
+private:
+  Node *m_current;   // the Node whose visitation member function is running
+  bool m_visit_kids; // true if visit_children was called on m_current
+
 public:
   ASTVisitor();
   virtual ~ASTVisitor();
@@ -64,10 +76,19 @@ EOF_VISIT_FN
   end
 
   outf.print <<"EOF2"
-  //! Call `visit` on each child Node of the given parent Node.
+  //! Call `visit` on each child Node of the given parent Node
+  //! (and, in turn, on their children if their visitation member
+  //! functions call `visit_children`.) If the parent Node is the
+  //! Node currently being visited, the children are visited after
+  //! its visitation member function returns.
   //! @param n the parent Node whose children should be visited
   virtual void visit_children(Node *n);
 
+  //! This method is called when a Node visited by `visit_children`
+  //! is left, i.e., after its children (if any) have been visited.
+  //! @param n the Node being left
+  virtual void leave(Node *n);
+
   //! This method is called if the Node being visited is a token
   //! (terminal symbol).
   //! @param n the token (terminal symbol) Node
@@ -85,7 +106,9 @@ def gen_ast_visitor_cpp(outf, ast_tags)
 #include "ast.h"
 #include "ast_visitor.h"
 
-ASTVisitor::ASTVisitor() {
+ASTVisitor::ASTVisitor()
+  : m_current(nullptr)
+  , m_visit_kids(false) {
 }
 
 ASTVisitor::~ASTVisitor() {
@@ -126,9 +149,45 @@ EOF5
 }
 
 void ASTVisitor::visit_children(Node *n) {
-  for (auto i = n->cbegin(); i != n->cend(); ++i) {
-    visit(*i);
+  if (n == m_current) {
+    // the enclosing traversal will visit the children once
+    // the current visitation member function returns
+    m_visit_kids = true;
+    return;
   }
+
+  // Visit the subtree using an explicit stack. The Node whose
+  // visitation member function is running (if any) is restored
+  // afterwards (even if an exception is thrown), since the
+  // function may continue to call visit_children.
+  struct Restore {
+    ASTVisitor *v;
+    Node *current;
+    bool visit_kids;
+    ~Restore() { v->m_current = current; v->m_visit_kids = visit_kids; }
+  } restore = { this, m_current, m_visit_kids };
+
+  n->traverse(
+    [this](Node *kid, unsigned depth) {
+      if (depth == 0) {
+        return TRAVERSE_CONTINUE;
+      }
+      m_current = kid;
+      m_visit_kids = false;
+      visit(kid);
+      m_current = nullptr;
+      return m_visit_kids ? TRAVERSE_CONTINUE : TRAVERSE_SKIP_KIDS;
+    },
+    [this](Node *kid, unsigned depth) {
+      if (depth > 0) {
+        leave(kid);
+      }
+      return TRAVERSE_CONTINUE;
+    });
+}
+
+void ASTVisitor::leave(Node *n) {
+  // default implementation does nothing
 }
 
 void ASTVisitor::visit_token(Node *n) {
@@ -0,0 +1,66 @@
+#! /usr/bin/env ruby
+
+# Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included
+# in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+# OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+# ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+
+
+# Generate a C source file with a given number of top-level
+# declarations (global variables, function prototypes, and function
+# definitions), for use as input to the benchmarks, e.g.
+#
+#   ./gen_bench_input.rb 100000 > big.c
+#
+# The identifiers are different in each declaration, so the number
+# of distinct strings grows with the size of the input.
+
+if ARGV.size != 1 || ARGV[0].to_i <= 0
+  STDERR.puts "Usage: gen_bench_input.rb <number of declarations>"
+  exit 1
+end
+num_decls = ARGV[0].to_i
+
+out = STDOUT
+(0...num_decls).each do |i|
+  case i % 4
+  when 0
+    out.puts "int g#{i}, *p#{i}, a#{i}[#{i % 100 + 1}];"
+  when 1
+    out.puts "int f#{i}(int *p, int n);"
+  when 2
+    out.puts <<"EOF1"
+int f#{i}(int *p, int n) {
+  int i, sum;
+  sum = 0;
+  for (i = 0; i < n; i++) {
+    if (p[i] > #{i}) {
+      sum += p[i] * 2;
+    } else {
+      sum = sum - f#{i - 1}(p + i, n - i);
+    }
+  }
+  while (sum > 1000) {
+    sum = sum / 2;
+  }
+  return sum;
+}
+EOF1
+  else
+    out.puts "void h#{i}(void) { g#{i - 3} = f#{i - 1}(p#{i - 3}, #{i}); }"
+  end
+end
@@ -0,0 +1,151 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Benchmark for the ways the lexer gets its input (see SourceBuffer).
+// A large input file (e.g., one generated by gen_bench_input.rb) is
+// loaded (and each byte is read, as the lexer would), and then
+// scanned into tokens
+//   - from the file, which is memory-mapped and scanned in place,
+//   - through a pipe, which can't be mapped, so it is read into
+//     a heap buffer (a thread writes the file's text to the pipe), and
+//   - from a copy of the text in memory (Context::scan_tokens_string())
+// The text is read into memory first, so the file is in the page
+// cache, and no mode has to wait for the disk.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <unistd.h>
+#include "nearly_c.h"
+#include "source_buffer.h"
+
+namespace {
+
+// Number of times each mode is run (the fastest time is used)
+const unsigned NUM_RUNS = 5;
+
+std::string read_source(const char *filename) {
+  FILE *in = fopen(filename, "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "Couldn't open '%s'\n", filename);
+    exit(1);
+  }
+  std::string text;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    text.append(buf, n);
+  }
+  fclose(in);
+  return text;
+}
+
+// Call a function with the name of a pipe through which the text
+// can be read: a thread writes the text to the pipe
+void through_pipe(const std::string &text, const std::function<void(const std::string &)> &fn) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    fprintf(stderr, "Couldn't create pipe\n");
+    exit(1);
+  }
+  std::thread writer([&]() {
+    size_t pos = 0;
+    while (pos < text.size()) {
+      ssize_t n = write(fds[1], text.data() + pos, text.size() - pos);
+      if (n <= 0) {
+        break;
+      }
+      pos += size_t(n);
+    }
+    close(fds[1]);
+  });
+  // the whole input is read before it is used, so the
+  // writer is done by the time fn returns
+  fn("/dev/fd/" + std::to_string(fds[0]));
+  writer.join();
+  close(fds[0]);
+}
+
+// Load a file into a SourceBuffer, and read each byte of the
+// text (returning a value computed from them, so that the reads
+// aren't optimized away)
+unsigned load(SourceBuffer &buf, const std::string &filename) {
+  buf.load_file(filename);
+  unsigned sum = 0;
+  const char *data = buf.get_data();
+  for (size_t i = 0; i < buf.get_size(); ++i) {
+    sum += (unsigned char) data[i];
+  }
+  return sum;
+}
+
+// Run a function several times, and print the fastest time
+void run(const char *mode, size_t size, const std::function<void()> &fn) {
+  double best_ms = 0.0;
+  for (unsigned i = 0; i < NUM_RUNS; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = end - start;
+    best_ms = (i == 0) ? elapsed.count() : std::min(best_ms, elapsed.count());
+  }
+  printf("  %-24s %10.1f ms %10.1f MB/s\n", mode, best_ms, size / (best_ms * 1000.0));
+}
+
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: input_bench <filename>\n");
+    exit(1);
+  }
+  const char *filename = argv[1];
+  std::string text = read_source(filename);
+
+  try {
+    SourceBuffer buf;
+    unsigned sum = 0;
+    printf("loading %s: %zu bytes\n", filename, text.size());
+    run("memory-mapped file:", text.size(), [&]() { sum += load(buf, filename); });
+    run("read from pipe:", text.size(), [&]() {
+      through_pipe(text, [&](const std::string &name) { sum += load(buf, name); });
+    });
+    if (sum == 0) {
+      printf("(empty input)\n");
+    }
+
+    Context ctx;
+    printf("scanning %s:\n", filename);
+    run("memory-mapped file:", text.size(), [&]() { ctx.scan_tokens(filename); });
+    run("read from pipe:", text.size(), [&]() {
+      through_pipe(text, [&](const std::string &name) { ctx.scan_tokens(name); });
+    });
+    run("copied from memory:", text.size(), [&]() { ctx.scan_tokens_string(text, filename); });
+  } catch (BaseException &ex) {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    exit(1);
+  }
+
+  return 0;
+}
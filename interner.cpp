@@ -0,0 +1,171 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <mutex>
+#include <cstring>
+#include <cassert>
+#include "exceptions.h"
+#include "interner.h"
+
+namespace {
+
+// The string data is copied into large blocks of characters
+const size_t CHAR_BLOCK_SIZE = 65536;
+
+}
+
+const unsigned Interner::MAX_SYMBOLS = 256U * ((1U << NUM_SEGMENTS) - 1);
+
+Interner::Interner()
+  : m_num_symbols(0)
+  , m_char_block_bytes(0)
+  , m_num_char_blocks_used(0)
+  , m_block_pos(nullptr)
+  , m_block_end(nullptr) {
+  // symbol id 0 is the empty string
+  m_segments[0].reset(new std::string_view[get_segment_start(1)]);
+  m_segments[0][0] = std::string_view();
+  m_ids[std::string_view()] = EMPTY;
+  m_num_symbols = 1;
+}
+
+Interner::~Interner() {
+}
+
+Interner &Interner::get_global() {
+  static Interner s_global;
+  return s_global;
+}
+
+unsigned Interner::intern(std::string_view str) {
+  unsigned sym;
+  if (!try_intern(str, sym)) {
+    RuntimeError::raise("Too many distinct strings");
+  }
+  return sym;
+}
+
+unsigned Interner::store(std::string_view str) {
+  unsigned sym;
+  if (!try_store(str, sym)) {
+    RuntimeError::raise("Too many distinct strings");
+  }
+  return sym;
+}
+
+bool Interner::try_intern(std::string_view str, unsigned &sym) {
+  // the string has most likely been interned already
+  {
+    std::shared_lock<std::shared_mutex> guard(m_lock);
+    auto i = m_ids.find(str);
+    if (i != m_ids.end()) {
+      sym = i->second;
+      return true;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> guard(m_lock);
+
+  // another thread might have interned the string in the meantime
+  auto i = m_ids.find(str);
+  if (i != m_ids.end()) {
+    sym = i->second;
+    return true;
+  }
+
+  if (!add(str, sym)) {
+    return false;
+  }
+  m_ids[get(sym)] = sym;
+  return true;
+}
+
+bool Interner::try_store(std::string_view str, unsigned &sym) {
+  if (str.empty()) {
+    sym = EMPTY;
+    return true;
+  }
+  std::unique_lock<std::shared_mutex> guard(m_lock);
+  return add(str, sym);
+}
+
+unsigned Interner::get_num_symbols() {
+  std::shared_lock<std::shared_mutex> guard(m_lock);
+  return m_num_symbols;
+}
+
+size_t Interner::get_memory_size() {
+  std::shared_lock<std::shared_mutex> guard(m_lock);
+  size_t size = m_char_block_bytes;
+  for (unsigned i = 0; i < NUM_SEGMENTS && m_segments[i]; ++i) {
+    size += (get_segment_start(i + 1) - get_segment_start(i)) * sizeof(std::string_view);
+  }
+  // each entry in the hash table is a separately allocated
+  // node with a pointer to the next entry
+  size += m_ids.bucket_count() * sizeof(void *)
+    + m_ids.size() * (sizeof(void *) + sizeof(std::pair<const std::string_view, unsigned>));
+  return size;
+}
+
+void Interner::clear() {
+  // the segments and character blocks are kept for reuse
+  m_ids.clear();
+  m_ids[std::string_view()] = EMPTY;
+  m_num_symbols = 1;
+  m_num_char_blocks_used = 0;
+  m_block_pos = nullptr;
+  m_block_end = nullptr;
+}
+
+// Copy a string and assign it the next symbol id (the
+// lock must be held exclusively)
+bool Interner::add(std::string_view str, unsigned &sym) {
+  if (m_num_symbols >= MAX_SYMBOLS) {
+    return false;
+  }
+
+  sym = m_num_symbols;
+  unsigned segment = get_segment(sym);
+  if (!m_segments[segment]) {
+    m_segments[segment].reset(new std::string_view[get_segment_start(segment + 1) - get_segment_start(segment)]);
+  }
+  m_segments[segment][sym - get_segment_start(segment)] = copy_chars(str);
+  m_num_symbols++;
+  return true;
+}
+
+// Copy string data into a character block
+std::string_view Interner::copy_chars(std::string_view str) {
+  if (size_t(m_block_end - m_block_pos) < str.size()) {
+    // use the next block (if it is large enough), or a new one
+    size_t block_size = std::max(CHAR_BLOCK_SIZE, str.size());
+    if (m_num_char_blocks_used == m_char_blocks.size() || str.size() > CHAR_BLOCK_SIZE) {
+      m_char_blocks.emplace(m_char_blocks.begin() + m_num_char_blocks_used, new char[block_size]);
+      m_char_block_bytes += block_size;
+    }
+    m_block_pos = m_char_blocks[m_num_char_blocks_used++].get();
+    m_block_end = m_block_pos + block_size;
+  }
+  char *copy = m_block_pos;
+  memcpy(copy, str.data(), str.size());
+  m_block_pos += str.size();
+  return std::string_view(copy, str.size());
+}
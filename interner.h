@@ -0,0 +1,151 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <string_view>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <shared_mutex>
+
+//! An Interner is a table of strings in which each distinct interned
+//! string (such as an identifier or string literal) is stored exactly
+//! once and is identified by an integer symbol id. Two interned strings
+//! are equal if and only if their symbol ids are equal, so comparing
+//! them is an O(1) operation. Strings which won't be compared (e.g., the
+//! lexemes of numbers and punctuators) can be stored without being
+//! interned, which is cheaper, since no hashing is needed: each one gets
+//! its own symbol id.
+//!
+//! Each Context has its own Interner, which is cleared when the Context
+//! moves to the next input (along with the tree, whose Nodes refer to
+//! strings using symbol ids), so it doesn't grow without bound. Nodes
+//! use the Interner of their NodeArena (see NodeArena::set_interner()),
+//! or the global Interner (see get_global()) if they are allocated on
+//! the heap or their arena has no Interner.
+//!
+//! An Interner may be used from multiple threads, except that clear()
+//! must not be called while it is in use by another thread.
+class Interner {
+private:
+  // Symbol ids are assigned consecutively, and the strings are stored
+  // in segments whose sizes double (so that there are only a few of
+  // them), which are never moved or freed once allocated. Because of
+  // this, looking up a string by symbol id doesn't require any locking:
+  // a thread can only know a symbol id if the string was already stored.
+  static const unsigned NUM_SEGMENTS = 20;
+
+  std::shared_mutex m_lock;
+  std::unordered_map<std::string_view, unsigned> m_ids;
+  std::unique_ptr<std::string_view[]> m_segments[NUM_SEGMENTS];
+  unsigned m_num_symbols;
+  std::vector<std::unique_ptr<char[]>> m_char_blocks;
+  size_t m_char_block_bytes; // total size of the character blocks
+  size_t m_num_char_blocks_used;
+  char *m_block_pos, *m_block_end;
+
+  // copy ctor and assignment operator not allowed
+  Interner(const Interner &);
+  Interner &operator=(const Interner &);
+
+public:
+  //! Symbol id of the empty string.
+  static const unsigned EMPTY = 0;
+
+  //! Maximum number of symbol ids.
+  static const unsigned MAX_SYMBOLS;
+
+  Interner();
+  ~Interner();
+
+  //! Get the global Interner, used by Nodes which don't belong
+  //! to an arena with its own Interner. Strings are never removed
+  //! from it, so its views remain valid for the lifetime of the program.
+  //! @return the global Interner
+  static Interner &get_global();
+
+  //! Intern a string. Throws RuntimeError if there are too many
+  //! symbol ids.
+  //! @param str the string to intern
+  //! @return the string's symbol id
+  unsigned intern(std::string_view str);
+
+  //! Store a string without interning it: it gets a new symbol id, even
+  //! if an equal string was stored or interned before. Throws RuntimeError
+  //! if there are too many symbol ids.
+  //! @param str the string to store
+  //! @return the string's symbol id
+  unsigned store(std::string_view str);
+
+  //! Intern a string, without throwing an exception if there are too
+  //! many symbol ids (e.g., when called from a parser action.)
+  //! @param str the string to intern
+  //! @param sym set to the string's symbol id
+  //! @return true if successful, false if there are too many symbol ids
+  bool try_intern(std::string_view str, unsigned &sym);
+
+  //! Store a string without interning it (see store()), without throwing
+  //! an exception if there are too many symbol ids.
+  //! @param str the string to store
+  //! @param sym set to the string's symbol id
+  //! @return true if successful, false if there are too many symbol ids
+  bool try_store(std::string_view str, unsigned &sym);
+
+  //! Get the string with given symbol id.
+  //! @param sym a symbol id returned by `intern` or `store`
+  //! @return view of the string, which remains valid until
+  //!         the Interner is cleared or destroyed
+  std::string_view get(unsigned sym) const {
+    unsigned segment = get_segment(sym);
+    return m_segments[segment][sym - get_segment_start(segment)];
+  }
+
+  //! Get the number of symbol ids assigned so far
+  //! (including the one for the empty string).
+  //! @return the number of symbol ids
+  unsigned get_num_symbols();
+
+  //! Get the amount of memory used by the Interner: the string data,
+  //! the table of strings by symbol id, and (approximately) the hash
+  //! table of interned strings. Memory retained for reuse after the
+  //! Interner is cleared is included.
+  //! @return the number of bytes used
+  size_t get_memory_size();
+
+  //! Remove all of the strings (other than the empty string), so that
+  //! the memory used for them can be reused. Views of the strings, and
+  //! symbol ids, obtained previously must no longer be used.
+  void clear();
+
+private:
+  static unsigned get_segment(unsigned sym) {
+    // segment k has 256 << k symbol ids, starting at 256 * (2^k - 1)
+    unsigned q = (sym >> 8) + 1;
+    return unsigned(31 - __builtin_clz(q));
+  }
+  static unsigned get_segment_start(unsigned segment) { return 256U * ((1U << segment) - 1); }
+  bool add(std::string_view str, unsigned &sym);
+  std::string_view copy_chars(std::string_view str);
+};
+
+#endif // INTERNER_H
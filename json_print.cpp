@@ -0,0 +1,143 @@
+// Copyright (c) 2021-2022, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <string_view>
+#include "node.h"
+#include "token_table.h"
+#include "file_table.h"
+#include "grammar_symbols.h"
+#include "output_sink.h"
+#include "json_print.h"
+
+namespace {
+
+// Write a string as a quoted JSON string
+void write_string(OutputSink &out, std::string_view str) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+
+  out.append('"');
+  size_t start = 0;
+  for (size_t i = 0; i < str.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(str[i]);
+    if (c == '"' || c == '\\' || c < 0x20) {
+      out.append(str.substr(start, i - start));
+      out.append('\\');
+      if (c == '"' || c == '\\') {
+        out.append(char(c));
+      } else if (c == '\n') {
+        out.append('n');
+      } else if (c == '\t') {
+        out.append('t');
+      } else if (c == '\r') {
+        out.append('r');
+      } else {
+        out.append("u00");
+        out.append(HEX_DIGITS[c >> 4]);
+        out.append(HEX_DIGITS[c & 0xF]);
+      }
+      start = i + 1;
+    }
+  }
+  out.append(str.substr(start));
+  out.append('"');
+}
+
+}
+
+JSONPrint::JSONPrint()
+  : m_file_id(0)
+  , m_file(nullptr) {
+}
+
+JSONPrint::~JSONPrint() {
+}
+
+void JSONPrint::print_tokens(const TokenTable &tokens, OutputSink &out) {
+  for (unsigned i = 0; i < tokens.get_num_tokens(); ++i) {
+    const Token &tok = tokens.get_token(i);
+    const char *name = get_grammar_symbol_name(tok.tag);
+    out.append("{\"tag\":");
+    out.append_int(tok.tag);
+    out.append(",\"name\":");
+    write_string(out, name != nullptr ? name : "");
+    out.append(",\"lexeme\":");
+    write_string(out, tokens.get_lexeme(i));
+    print_loc(tokens.get_file_id(), tok.offset, out);
+    out.append("}\n");
+  }
+}
+
+void JSONPrint::print_tree(Node *root, OutputSink &out) {
+  // Each node's object is opened when the node is entered, and closed
+  // when it is left. A comma is needed before every object except
+  // the first child of a node (or the root.)
+  bool first = true;
+  root->traverse(
+    [&](Node *n, unsigned) {
+      if (!first) {
+        out.append(',');
+      }
+      first = false;
+      out.append("{\"tag\":");
+      out.append_int(n->get_tag());
+      out.append(",\"name\":");
+      write_string(out, get_tag_name(n->get_tag()));
+      std::string_view str = n->get_str_view();
+      if (!str.empty()) {
+        out.append(",\"str\":");
+        write_string(out, str);
+      }
+      const Location &loc = n->get_loc();
+      if (loc.is_valid()) {
+        print_loc(loc.get_file_id(), loc.get_offset(), out);
+      }
+      if (n->get_num_kids() > 0) {
+        out.append(",\"kids\":[");
+        first = true;
+      }
+      return TRAVERSE_CONTINUE;
+    },
+    [&](Node *n, unsigned) {
+      out.append(n->get_num_kids() > 0 ? "]}" : "}");
+      first = false;
+      return TRAVERSE_CONTINUE;
+    });
+  out.append('\n');
+}
+
+const std::string &JSONPrint::get_tag_name(int tag) {
+  auto i = m_tag_names.find(tag);
+  if (i == m_tag_names.end()) {
+    i = m_tag_names.insert({ tag, m_tag_print.node_tag_to_string(tag) }).first;
+  }
+  return i->second;
+}
+
+void JSONPrint::print_loc(unsigned file_id, unsigned offset, OutputSink &out) {
+  // look up the SourceFile once, rather than for every Location
+  if (file_id != m_file_id) {
+    m_file = FileTable::get_file(file_id);
+    m_file_id = file_id;
+  }
+  out.append(",\"line\":");
+  out.append_int(m_file->get_line(offset));
+  out.append(",\"col\":");
+  out.append_int(m_file->get_col(offset));
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2021-2022, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef JSON_PRINT_H
+#define JSON_PRINT_H
+
+#include <string>
+#include <unordered_map>
+#include "ast.h"
+class Node;
+class TokenTable;
+class SourceFile;
+class OutputSink;
+
+//! Prints tokens and trees as JSON, for programs which need the
+//! tags, lexemes, and source locations. The output is written to an
+//! OutputSink as the tokens or tree nodes are visited, so no memory
+//! is needed for the output itself.
+//!
+//! Tokens are printed as NDJSON (newline-delimited JSON): one object
+//! per line, e.g.
+//!
+//!     {"tag":300,"name":"TOK_IDENT","lexeme":"sum","line":1,"col":5}
+//!
+//! A tree is printed on one line as a single object for its root.
+//! Each node's object has the members `tag`, `name` (the tag as
+//! a string, from ASTTreePrint::node_tag_to_string()), `str` (if the
+//! node has a string value), `line` and `col` (if the node has a source
+//! Location), and `kids` (an array of the children's objects, if the
+//! node has children.) Several trees (e.g., the top-level declarations
+//! printed in streaming mode) are therefore printed as NDJSON.
+class JSONPrint {
+private:
+  ASTTreePrint m_tag_print;
+  std::unordered_map<int, std::string> m_tag_names;
+  unsigned m_file_id;
+  const SourceFile *m_file;
+
+  // copy ctor and assignment operator not allowed
+  JSONPrint(const JSONPrint &);
+  JSONPrint &operator=(const JSONPrint &);
+
+public:
+  JSONPrint();
+  ~JSONPrint();
+
+  //! Print tokens as NDJSON.
+  //! @param tokens the tokens
+  //! @param out the OutputSink to print to
+  void print_tokens(const TokenTable &tokens, OutputSink &out);
+
+  //! Print a tree as JSON, followed by a newline.
+  //! @param root the root of the tree
+  //! @param out the OutputSink to print to
+  void print_tree(Node *root, OutputSink &out);
+
+private:
+  const std::string &get_tag_name(int tag);
+  void print_loc(unsigned file_id, unsigned offset, OutputSink &out);
+};
+
+#endif // JSON_PRINT_H
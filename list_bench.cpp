@@ -0,0 +1,99 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Regression benchmark for building lists (e.g., the list of top-level
+// declarations in the unit): parses a small and a large input (e.g.,
+// with 10,000 and 100,000 top-level declarations, generated by
+// gen_bench_input.rb), and compares the time per byte of source text.
+// Since building lists takes linear time, the time per byte should be
+// about the same for both inputs: if parsing the large input takes
+// much longer per byte, the benchmark fails.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include "nearly_c.h"
+
+namespace {
+
+// Number of times each input is parsed (the fastest time is used)
+const unsigned NUM_RUNS = 3;
+
+// Maximum ratio of the time per byte for the large input
+// to the time per byte for the small input
+const double MAX_RATIO = 1.5;
+
+// Parse an input several times, and return the
+// fastest time in nanoseconds per byte
+double parse_time_per_byte(Context &ctx, const char *filename) {
+  FILE *in = fopen(filename, "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "Couldn't open '%s'\n", filename);
+    exit(1);
+  }
+  fseek(in, 0, SEEK_END);
+  long size = ftell(in);
+  fclose(in);
+
+  double best_ms = 0.0;
+  for (unsigned i = 0; i < NUM_RUNS; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    ctx.parse(filename);
+    auto end = std::chrono::steady_clock::now();
+    // destroying the tree isn't part of the time
+    ctx.clear_ast();
+
+    std::chrono::duration<double, std::milli> elapsed = end - start;
+    best_ms = (i == 0) ? elapsed.count() : std::min(best_ms, elapsed.count());
+  }
+
+  double ns_per_byte = best_ms * 1e6 / std::max(size, 1L);
+  printf("%s: %ld bytes, %.1f ms (%.2f ns/byte)\n", filename, size, best_ms, ns_per_byte);
+  return ns_per_byte;
+}
+
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: list_bench <small input> <large input>\n");
+    exit(1);
+  }
+
+  double ratio;
+  try {
+    Context ctx;
+    double small = parse_time_per_byte(ctx, argv[1]);
+    double large = parse_time_per_byte(ctx, argv[2]);
+    ratio = large / small;
+  } catch (BaseException &ex) {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    exit(1);
+  }
+
+  printf("time per byte, large input / small input: %.2f (at most %.2f expected)\n", ratio, MAX_RATIO);
+  if (ratio > MAX_RATIO) {
+    printf("Parsing the large input is too slow: building lists isn't linear\n");
+    return 1;
+  }
+  return 0;
+}
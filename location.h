@@ -26,53 +26,52 @@
 //! A Location represents a source code location.
 //! Each token and (in theory) each AST node will have a Location.
 //! Location objects have value semantics (can be copied and assigned.)
+//!
+//! To keep Locations small and cheap to copy, a Location consists of
+//! just the id of its source file in the FileTable and a byte offset
+//! in the source file. The source file name, line number, and column
+//! number are looked up in the FileTable when they are needed.
 class Location {
 private:
-  std::string m_srcfile;
-  int m_line, m_col;
+  unsigned m_file_id;
+  unsigned m_offset;
 
 public:
   //! Default constructor. The Location will be invalid.
-  Location();
+  Location() : m_file_id(0), m_offset(0) { }
 
-  //! Location from source file, line number, and column number.
-  //! @param srcfile the name of the source file
-  //! @param line the line number
-  //! @param col the column number
-  Location(const std::string &srcfile, int line, int col);
-
-  //! Copy constructor.
-  //! @param other the Location object to copy from
-  Location(const Location &other);
-
-  ~Location();
-
-  //! Assignment operator.
-  //! @param rhs the Location object to copy from
-  Location &operator=(const Location &rhs);
+  //! Location from source file id and byte offset.
+  //! @param file_id the source file's id in the FileTable
+  //! @param offset the byte offset in the source file
+  Location(unsigned file_id, unsigned offset) : m_file_id(file_id), m_offset(offset) { }
 
   //! Check whether this Location is valid.
   //! @return true if this Location is valid, false if not
-  bool is_valid() const { return m_line > 0; }
+  bool is_valid() const { return m_file_id != 0; }
+
+  //! Get the source file id.
+  //! @return the source file id
+  unsigned get_file_id() const { return m_file_id; }
+
+  //! Get the byte offset in the source file.
+  //! @return the byte offset
+  unsigned get_offset() const { return m_offset; }
 
   //! Get the source file name.
   //! @return the source file name
-  std::string get_srcfile() const { return m_srcfile; }
+  std::string get_srcfile() const;
 
   //! Get the source line number (1 for the first line).
   //! @return the source line number
-  int get_line() const { return m_line; }
+  int get_line() const;
 
   //! Get the source column number (1 for the first column).
   //! @return the source column number
-  int get_col() const { return m_col; }
+  int get_col() const;
 
   //! Advance the Location by the given number of character positions.
   //! @param num_cols the number of character positions to advance
-  void advance(int num_cols) { m_col += num_cols; }
-
-  //! Advance the Location to the beginning of the next line.
-  void next_line() { m_line++; m_col = 1; }
+  void advance(int num_cols) { m_offset += unsigned(num_cols); }
 };
 
 #endif // LOCATION_H
@@ -19,19 +19,59 @@
 // OTHER DEALINGS IN THE SOFTWARE.
 
 #include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <unistd.h>
 #include "context.h"
 #include "ast.h"
 #include "print_graph.h"
 #include "grammar_symbols.h"
 #include "node.h"
 #include "exceptions.h"
+#include "cpputil.h"
+#include "thread_pool.h"
+#include "server.h"
+#include "ast_cache.h"
+#include "tree_format.h"
+#include "output_sink.h"
+#include "json_print.h"
+#include "parse_stats.h"
 
 void usage() {
-  fprintf(stderr, "Usage: nearly_c [options...] <filename>\n"
+  fprintf(stderr, "Usage: nearly_c [options...] <filename>...\n"
                   "Options:\n"
-                  "  -l   print tokens\n"
-                  "  -p   print parse tree\n"
-                  "  -g   print graph (DOT/graphviz)\n");
+                  "  -l     print tokens\n"
+                  "  -p     print parse tree\n"
+                  "  -g     print graph (DOT/graphviz)\n"
+                  "  --depth N\n"
+                  "         with -g, don't print nodes more than N levels deep\n"
+                  "  --function NAME\n"
+                  "         with -g, only print the function called NAME\n"
+                  "  --clusters\n"
+                  "         with -g, draw each function in its own cluster\n"
+                  "  --json with -l, print tokens as NDJSON; with -p, print tree as JSON\n"
+                  "  -b     write tree in binary format (see tree_format.h)\n"
+                  "  -j N   process files using N threads\n"
+                  "  -P     pipeline lexing and parsing (lexer runs in its own thread)\n"
+                  "  -L N   scan large files using N threads\n"
+                  "  -D N   parse top-level declarations using N threads\n"
+                  "  -B     don't parse function bodies (declarations only)\n"
+                  "  -S     streaming mode: with -p, print each top-level declaration\n"
+                  "         as soon as it is parsed, then discard it (can't be used\n"
+                  "         with -g or -b, which need the whole tree)\n"
+                  "  -C DIR use DIR as a cache of parsed trees\n"
+                  "  --max-errors N\n"
+                  "         report up to N errors for each file (default 1)\n"
+                  "  --stats\n"
+                  "         print the time spent in each phase, and memory statistics\n"
+                  "         (as JSON with --json)\n"
+                  "  --server [SOCKET]\n"
+                  "         handle requests from a Unix domain socket (or stdin), using\n"
+                  "         warm state (the -j option sets the number of worker threads)\n");
   exit(1);
 }
 
@@ -39,81 +79,441 @@ enum class Mode {
   PRINT_TOKENS,
   PRINT_PARSE_TREE,
   PRINT_GRAPH,
+  PRINT_BINARY,
   COMPILE,
 };
 
-void process_source_file(const std::string &filename, Mode mode);
+// Options specified on the command line
+struct Options {
+  Mode mode;
+  unsigned num_threads;
+  bool pipelined;
+  unsigned num_scan_threads;
+  unsigned num_parse_threads;
+  bool lazy_bodies;
+  bool streaming;
+  std::string cache_dir;
+  AstCache *cache;
+  unsigned graph_max_depth;
+  std::string graph_function;
+  bool graph_clusters;
+  bool json;
+  unsigned error_limit;
+  bool print_stats;
+  ParseStats *stats;
+
+  Options()
+    : mode(Mode::COMPILE), num_threads(0), pipelined(false)
+    , num_scan_threads(1), num_parse_threads(1), lazy_bodies(false)
+    , streaming(false), cache(nullptr), graph_max_depth(0)
+    , graph_clusters(false), json(false), error_limit(1)
+    , print_stats(false), stats(nullptr) { }
+};
+
+// Result of processing one source file in multi-file mode
+struct FileResult {
+  std::string output;
+  std::string diagnostics;
+  bool success;
+
+  FileResult() : success(false) { }
+};
+
+void configure_context(Context &ctx, const Options &opts);
+void process_source_file(Context &ctx, const std::string &filename, const Options &opts, OutputSink &out);
+std::string format_error(const BaseException &ex, const std::string &filename);
+std::string format_errors(const Context &ctx, const BaseException &ex, const std::string &filename);
+bool process_source_file_buffered(Context &ctx, const std::string &filename, const Options &opts,
+                                  std::string &output, std::string &diagnostics);
+int process_source_files(const std::vector<std::string> &filenames, const Options &opts);
+int run_server(const Options &opts, const std::string &socket_path);
 
 int main(int argc, char **argv) {
   if (argc < 2) {
     usage();
   }
 
-  Mode mode = Mode::COMPILE;
+  Options opts;
+  bool server = false;
+  std::string socket_path;
 
   int index = 1;
   while (index < argc) {
     std::string arg(argv[index]);
     if (arg == "-l") {
-      mode = Mode::PRINT_TOKENS;
+      opts.mode = Mode::PRINT_TOKENS;
     } else if (arg == "-p") {
-      mode = Mode::PRINT_PARSE_TREE;
+      opts.mode = Mode::PRINT_PARSE_TREE;
     } else if (arg == "-g") {
-      mode = Mode::PRINT_GRAPH;
+      opts.mode = Mode::PRINT_GRAPH;
+    } else if (arg == "-b") {
+      opts.mode = Mode::PRINT_BINARY;
+    } else if (arg == "--depth") {
+      if (index + 1 >= argc || (opts.graph_max_depth = unsigned(atoi(argv[index + 1]))) == 0) {
+        usage();
+      }
+      index++;
+    } else if (arg == "--function") {
+      if (index + 1 >= argc) {
+        usage();
+      }
+      opts.graph_function = argv[++index];
+    } else if (arg == "--clusters") {
+      opts.graph_clusters = true;
+    } else if (arg == "--json") {
+      opts.json = true;
+    } else if (arg == "--max-errors") {
+      if (index + 1 >= argc || (opts.error_limit = unsigned(atoi(argv[index + 1]))) == 0) {
+        usage();
+      }
+      index++;
+    } else if (arg == "--stats") {
+      opts.print_stats = true;
+    } else if (arg == "-j") {
+      if (index + 1 >= argc || (opts.num_threads = unsigned(atoi(argv[index + 1]))) == 0) {
+        usage();
+      }
+      index++;
+    } else if (arg == "-L") {
+      if (index + 1 >= argc || (opts.num_scan_threads = unsigned(atoi(argv[index + 1]))) == 0) {
+        usage();
+      }
+      index++;
+    } else if (arg == "-D") {
+      if (index + 1 >= argc || (opts.num_parse_threads = unsigned(atoi(argv[index + 1]))) == 0) {
+        usage();
+      }
+      index++;
+    } else if (arg == "-P") {
+      opts.pipelined = true;
+    } else if (arg == "-B") {
+      opts.lazy_bodies = true;
+    } else if (arg == "-S") {
+      opts.streaming = true;
+    } else if (arg == "-C") {
+      if (index + 1 >= argc) {
+        usage();
+      }
+      opts.cache_dir = argv[++index];
+    } else if (arg == "--server") {
+      // the socket path is optional
+      server = true;
+      if (index + 1 < argc && argv[index + 1][0] != '-') {
+        socket_path = argv[++index];
+      }
     } else {
       break;
     }
     index++;
   }
 
-  if (index >= argc) {
+  if (!server && index >= argc) {
     usage();
   }
 
-  const char *filename = argv[index];
-  try {
-    process_source_file(filename, mode);
-  } catch (BaseException &ex) {
-    const Location &loc = ex.get_loc();
-    if (loc.is_valid()) {
-      fprintf(stderr, "%d:%d:Error: %s\n", loc.get_line(), loc.get_col(), ex.what());
-    } else {
-      fprintf(stderr, "Error: %s\n", ex.what());
+  // the graph and the binary tree are of the whole tree,
+  // which isn't available in streaming mode
+  if (opts.streaming && (opts.mode == Mode::PRINT_GRAPH || opts.mode == Mode::PRINT_BINARY)) {
+    usage();
+  }
+
+  std::unique_ptr<AstCache> cache;
+  if (!opts.cache_dir.empty()) {
+    try {
+      cache.reset(new AstCache(opts.cache_dir));
+    } catch (BaseException &ex) {
+      fprintf(stderr, "%s", format_error(ex, "").c_str());
+      exit(1);
     }
-    exit(1);
+    opts.cache = cache.get();
   }
 
-  return 0;
+  // statistics aren't gathered in server mode
+  ParseStats stats;
+  if (opts.print_stats && !server) {
+    opts.stats = &stats;
+  }
+
+  int result = 0;
+  std::vector<std::string> filenames(argv + index, argv + argc);
+  if (server) {
+    result = run_server(opts, socket_path);
+  } else if (filenames.size() > 1 || opts.num_threads > 0) {
+    if (opts.num_threads == 0) {
+      opts.num_threads = 1;
+    }
+    result = process_source_files(filenames, opts);
+  } else {
+    Context ctx;
+    configure_context(ctx, opts);
+    try {
+      OutputSink out(STDOUT_FILENO);
+      process_source_file(ctx, filenames[0], opts, out);
+      ParseStats::PhaseTimer timer(opts.stats, ParseStats::PHASE_PRINT);
+      out.flush();
+    } catch (BaseException &ex) {
+      fprintf(stderr, "%s", format_errors(ctx, ex, "").c_str());
+      result = 1;
+    }
+  }
+
+  if (cache) {
+    fprintf(stderr, "%s", cache->format_stats().c_str());
+  }
+  if (opts.stats != nullptr) {
+    std::string text = opts.json ? stats.format_json() : stats.format();
+    fprintf(stderr, "%s", text.c_str());
+  }
+
+  return result;
 }
 
-void process_source_file(const std::string &filename, Mode mode) {
-  Context ctx;
+void configure_context(Context &ctx, const Options &opts) {
+  ctx.set_pipelined(opts.pipelined);
+  ctx.set_num_scan_threads(opts.num_scan_threads);
+  ctx.set_num_parse_threads(opts.num_parse_threads);
+  ctx.set_lazy_bodies(opts.lazy_bodies);
+  ctx.set_cache(opts.cache);
+  ctx.set_error_limit(opts.error_limit);
+  ctx.set_stats(opts.stats);
+}
 
+void process_source_file(Context &ctx, const std::string &filename, const Options &opts, OutputSink &out) {
+  Mode mode = opts.mode;
   if (mode == Mode::PRINT_TOKENS) {
-    std::vector<Node *> tokens;
-    ctx.scan_tokens(filename, tokens);
-    for (auto i = tokens.begin(); i != tokens.end(); ++i) {
-      Node *tok = *i;
-      printf("%d:%s[%s]\n", tok->get_tag(), get_grammar_symbol_name(tok->get_tag()), tok->get_str().c_str());
-      delete tok;
+    ctx.scan_tokens(filename);
+    ParseStats::PhaseTimer timer(ctx.get_stats(), ParseStats::PHASE_PRINT);
+    const TokenTable &tokens = ctx.get_tokens();
+    if (opts.json) {
+      JSONPrint jp;
+      jp.print_tokens(tokens, out);
+      return;
+    }
+    for (unsigned i = 0; i < tokens.get_num_tokens(); ++i) {
+      int tag = tokens.get_token(i).tag;
+      std::string_view lexeme = tokens.get_lexeme(i);
+      out.append_int(tag);
+      out.append(':');
+      out.append(get_grammar_symbol_name(tag));
+      out.append('[');
+      out.append(lexeme);
+      out.append("]\n");
+    }
+  } else if (opts.streaming) {
+    // Parse the input, printing each top-level declaration
+    // (if requested) as soon as it is parsed
+    ASTTreePrint ptp;
+    JSONPrint jp;
+    ctx.parse_streaming(filename, [&](Node *decl) {
+      ParseStats::PhaseTimer timer(ctx.get_stats(), ParseStats::PHASE_PRINT);
+      if (mode == Mode::PRINT_PARSE_TREE && opts.json) {
+        jp.print_tree(decl, out);
+      } else if (mode == Mode::PRINT_PARSE_TREE) {
+        ptp.print(decl, out);
+      }
+    });
+    if (mode == Mode::COMPILE) {
+      out.append("TODO: compile the source code\n");
     }
   } else {
     // Parse the input
     ctx.parse(filename);
+    ParseStats::PhaseTimer timer(ctx.get_stats(), ParseStats::PHASE_PRINT);
 
-    if (mode == Mode::PRINT_PARSE_TREE) {
+    if (mode == Mode::PRINT_PARSE_TREE && opts.json) {
+      JSONPrint jp;
+      jp.print_tree(ctx.get_ast(), out);
+    } else if (mode == Mode::PRINT_PARSE_TREE) {
       // Note that we use an ASTTreePrint object to print the parse
       // tree. That way, the parser can build either a parse tree or
       // an AST, and tree printing should work correctly.
       Node *ast = ctx.get_ast();
       ASTTreePrint ptp;
-      ptp.print(ast);
+      ptp.print(ast, out);
     } else if (mode == Mode::PRINT_GRAPH) {
       Node *ast = ctx.get_ast();
-      PrintGraph agp(ast);
+      PrintGraph agp(ast, out);
+      agp.set_max_depth(opts.graph_max_depth);
+      agp.set_function(opts.graph_function);
+      agp.set_cluster_functions(opts.graph_clusters);
       agp.print();
+    } else if (mode == Mode::PRINT_BINARY) {
+      std::string data;
+      TreeWriter::write(ctx.get_ast(), data);
+      out.append(data);
     } else if (mode == Mode::COMPILE) {
-      printf("TODO: compile the source code\n");
+      out.append("TODO: compile the source code\n");
+    }
+  }
+}
+
+// Format an error message; if a filename is specified, it is
+// used as a prefix
+std::string format_error(const BaseException &ex, const std::string &filename) {
+  std::string prefix = filename.empty() ? "" : filename + ":";
+  if (ex.has_location()) {
+    return cpputil::format("%s%d:%d:Error: %s\n", prefix.c_str(), ex.get_line(), ex.get_col(), ex.what());
+  } else {
+    return cpputil::format("%sError: %s\n", prefix.c_str(), ex.what());
+  }
+}
+
+// Format the error messages for an input which couldn't be processed:
+// if the Context recorded errors (possibly several), all of them are
+// formatted, otherwise just the exception's
+std::string format_errors(const Context &ctx, const BaseException &ex, const std::string &filename) {
+  const Diagnostics &diagnostics = ctx.get_diagnostics();
+  if (diagnostics.empty()) {
+    return format_error(ex, filename);
+  }
+
+  std::string result;
+  for (unsigned i = 0; i < diagnostics.get_num_errors(); ++i) {
+    const Diagnostic &d = diagnostics.get_error(i);
+    result += format_error(SyntaxError(d.loc, d.msg), filename);
+  }
+  if (diagnostics.get_limit() > 1 && diagnostics.at_limit()) {
+    std::string prefix = filename.empty() ? "" : filename + ":";
+    result += cpputil::format("%sError: stopping after %u errors\n", prefix.c_str(), diagnostics.get_limit());
+  }
+  return result;
+}
+
+// Process a source file, buffering the output. Returns true if
+// successful, or false (with an error message in diagnostics)
+// if an error occurred.
+bool process_source_file_buffered(Context &ctx, const std::string &filename, const Options &opts,
+                                  std::string &output, std::string &diagnostics) {
+  output.clear();
+  OutputSink out(output);
+
+  bool success = false;
+  try {
+    process_source_file(ctx, filename, opts, out);
+    out.flush();
+    success = true;
+  } catch (BaseException &ex) {
+    out.flush();
+    diagnostics = format_errors(ctx, ex, filename);
+  }
+  return success;
+}
+
+// Process multiple source files concurrently. Each worker thread has
+// its own Context. The output and diagnostics for each file are buffered,
+// and are printed in the order in which the files were specified
+// (as soon as all of the earlier files are done), followed by a summary.
+int process_source_files(const std::vector<std::string> &filenames, const Options &opts) {
+  unsigned num_files = unsigned(filenames.size());
+  std::vector<FileResult> results(num_files);
+  std::vector<bool> done(num_files);
+  unsigned next_to_print = 0;
+  std::mutex print_lock;
+
+  // each worker has its own Context (and, if statistics are
+  // being gathered, its own ParseStats)
+  std::vector<std::unique_ptr<ParseStats>> stats;
+  std::vector<std::unique_ptr<Context>> contexts;
+  for (unsigned i = 0; i < opts.num_threads; ++i) {
+    contexts.emplace_back(new Context);
+    configure_context(*contexts.back(), opts);
+    if (opts.stats != nullptr) {
+      stats.emplace_back(new ParseStats);
+      contexts.back()->set_stats(stats.back().get());
     }
   }
+
+  ThreadPool pool(opts.num_threads);
+  pool.run(num_files, [&](unsigned worker, unsigned task) {
+    FileResult &result = results[task];
+    result.success = process_source_file_buffered(*contexts[worker], filenames[task], opts,
+                                                  result.output, result.diagnostics);
+
+    // print the results for all files which are done and
+    // which aren't preceded by a file that isn't done
+    std::lock_guard<std::mutex> guard(print_lock);
+    done[task] = true;
+    while (next_to_print < num_files && done[next_to_print]) {
+      FileResult &r = results[next_to_print];
+      fwrite(r.output.data(), 1, r.output.size(), stdout);
+      fflush(stdout);
+      fputs(r.diagnostics.c_str(), stderr);
+      r.output.clear();
+      ++next_to_print;
+    }
+  });
+
+  // the Contexts are destroyed first, so the time spent
+  // destroying their trees is recorded
+  contexts.clear();
+  for (auto i = stats.begin(); i != stats.end(); ++i) {
+    opts.stats->add(**i);
+  }
+
+  unsigned num_failed = 0;
+  for (unsigned i = 0; i < num_files; ++i) {
+    if (!results[i].success) {
+      ++num_failed;
+    }
+  }
+  fprintf(stderr, "%u file(s): %u succeeded, %u failed\n", num_files, num_files - num_failed, num_failed);
+  for (unsigned i = 0; i < num_files; ++i) {
+    if (!results[i].success) {
+      fprintf(stderr, "  FAILED: %s\n", filenames[i].c_str());
+    }
+  }
+
+  return num_failed > 0 ? 1 : 0;
+}
+
+// Handle requests (see Server) until a shutdown request is received
+// (or, if there is no socket, until the end of the standard input.)
+// The requests are "tokens FILE", "tree FILE" (print the parse tree
+// or AST, depending on which parser is used), "graph FILE", and
+// "binary FILE" (the tree in binary format.)
+int run_server(const Options &opts, const std::string &socket_path) {
+  auto handler = [&opts](Context &ctx, const std::string &command, const std::string &arg, std::string &reply) {
+    Options req_opts(opts);
+    if (command == "tokens") {
+      req_opts.mode = Mode::PRINT_TOKENS;
+    } else if (command == "tree" || command == "ast") {
+      req_opts.mode = Mode::PRINT_PARSE_TREE;
+    } else if (command == "graph") {
+      req_opts.mode = Mode::PRINT_GRAPH;
+      req_opts.streaming = false; // needs the whole tree
+    } else if (command == "binary") {
+      req_opts.mode = Mode::PRINT_BINARY;
+      req_opts.streaming = false; // needs the whole tree
+    } else {
+      reply = "Error: unknown request '" + command + "'\n";
+      return false;
+    }
+
+    std::string diagnostics;
+    if (!process_source_file_buffered(ctx, arg, req_opts, reply, diagnostics)) {
+      reply = diagnostics;
+      return false;
+    }
+    return true;
+  };
+
+  unsigned num_workers = socket_path.empty() ? 1 : std::max(opts.num_threads, 1U);
+  Server server(num_workers, handler);
+  for (unsigned i = 0; i < num_workers; ++i) {
+    configure_context(server.get_context(i), opts);
+  }
+
+  try {
+    if (socket_path.empty()) {
+      server.serve_stream(stdin, stdout);
+    } else {
+      server.serve_socket(socket_path);
+    }
+  } catch (BaseException &ex) {
+    fprintf(stderr, "%s", format_error(ex, "").c_str());
+    return 1;
+  }
+
+  fprintf(stderr, "%s", server.get_latency().format().c_str());
+  return 0;
 }
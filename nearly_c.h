@@ -0,0 +1,44 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NEARLY_C_H
+#define NEARLY_C_H
+
+//! @file
+//! Public API of the nearly_c library (libnearlyc). A program using
+//! the library creates a Context, and uses it to scan or parse source
+//! files (Context::scan_tokens(), Context::parse()) or source text in
+//! memory (Context::scan_tokens_string(), Context::parse_string()).
+//! The resulting tokens are available from Context::get_tokens(), and
+//! the tree from Context::get_ast(). Errors are reported by throwing
+//! exceptions derived from BaseException.
+//!
+//! A Context reuses its lexer state and memory for each input, so
+//! a program parsing many inputs should use the same Context for
+//! all of them (or one Context per thread.)
+
+#include "context.h"
+#include "node.h"
+#include "token_table.h"
+#include "grammar_symbols.h"
+#include "ast.h"
+#include "exceptions.h"
+
+#endif // NEARLY_C_H
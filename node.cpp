@@ -18,57 +18,93 @@
 // ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
 // OTHER DEALINGS IN THE SOFTWARE.
 
+#include <cstring>
 #include "node.h"
 
+namespace {
+
+// A Node in an arena which adopts a Node allocated on the heap must be
+// destroyed (to delete the child) when its arena is cleared, so the
+// arena is told about it
+void note_adopted(const Node *parent, const Node *kid) {
+  if (NodeArena::get_owner(kid) == nullptr) {
+    NodeArena *arena = NodeArena::get_owner(parent);
+    if (arena != nullptr) {
+      arena->note_heap_kid();
+    }
+  }
+}
+
+}
+
 // Private constructor, used only by other constructors
-Node::Node(int tag, const std::string &str, const std::vector<Node *> &kids)
+Node::Node(int tag, unsigned sym, const std::vector<Node *> &kids)
   : m_tag(tag)
-  , m_kids(kids)
-  , m_str(str)
-  , m_loc_was_set_explicitly(false) {
+  , m_sym(sym)
+  , m_num_kids(0)
+  , m_loc_was_set_explicitly(false)
+  , m_adopted(false) {
+  init_kids(kids.data(), unsigned(kids.size()));
 }
 
 // Private constructor, used only by other constructors
-Node::Node(int tag, const std::string &str, const std::initializer_list<Node *> kids)
+Node::Node(int tag, unsigned sym, const std::initializer_list<Node *> kids)
   : m_tag(tag)
-  , m_kids(kids)
-  , m_str(str)
-  , m_loc_was_set_explicitly(false) {
+  , m_sym(sym)
+  , m_num_kids(0)
+  , m_loc_was_set_explicitly(false)
+  , m_adopted(false) {
+  init_kids(kids.begin(), unsigned(kids.size()));
 }
 
 Node::Node(int tag)
-  : Node(tag, "", {}) {
+  : Node(tag, Interner::EMPTY, {}) {
 }
 
 Node::Node(int tag, std::initializer_list<Node *> kids)
-  : Node(tag, "", kids) {
+  : Node(tag, Interner::EMPTY, kids) {
   // parent node's location defaults to first kid's location
-  if (!m_kids.empty()) {
-    m_loc = m_kids[0]->get_loc();
+  if (m_num_kids > 0) {
+    m_loc = get_kids()[0]->get_loc();
   }
 }
 
 Node::Node(int tag, const std::vector<Node *> &kids)
-  : Node(tag, "", kids) {
+  : Node(tag, Interner::EMPTY, kids) {
   // parent node's location defaults to first kid's location
-  if (!m_kids.empty()) {
-    m_loc = m_kids[0]->get_loc();
+  if (m_num_kids > 0) {
+    m_loc = get_kids()[0]->get_loc();
   }
 }
 
 Node::Node(int tag, const std::string &str)
-  : Node(tag, str, {}) {
+  : Node(tag, Interner::EMPTY, {}) {
+  // the Node's memory (and so its arena) is known at this point
+  m_sym = get_interner().intern(str);
 }
 
 Node::~Node() {
-  // delete child nodes
-  for (auto i = m_kids.begin(); i != m_kids.end(); ++i) {
-    delete *i;
+  if (m_num_kids == 0) {
+    return;
+  }
+
+  // Delete descendants using an explicit worklist rather than
+  // recursion (so that deleting a very deep tree can't overflow
+  // the stack): each Node's children are moved to the worklist
+  // before the Node is deleted, so its destructor has no children
+  // to delete.
+  std::vector<Node *> work;
+  release_kids(work);
+  while (!work.empty()) {
+    Node *n = work.back();
+    work.pop_back();
+    n->release_kids(work);
+    delete n;
   }
 }
 
 void Node::append_kid(Node *kid) {
-  m_kids.push_back(kid);
+  insert_kid(m_num_kids, kid);
   // parent node's location defaults to first kid's location
   if (!m_loc.is_valid()) {
     m_loc = kid->get_loc();
@@ -76,7 +112,7 @@ void Node::append_kid(Node *kid) {
 }
 
 void Node::prepend_kid(Node *kid) {
-  m_kids.insert(m_kids.begin(), kid);
+  insert_kid(0, kid);
 
   // Here, we update the parent's location unconditionally
   // (since we generally want the parent's location to match that
@@ -87,10 +123,133 @@ void Node::prepend_kid(Node *kid) {
   }
 }
 
+void Node::append_kids_from(Node *other) {
+  Node *const *kids = other->get_kids();
+  for (unsigned i = 0; i < other->m_num_kids; ++i) {
+    append_kid(kids[i]);
+  }
+  if (other->m_num_kids > INLINE_KIDS) {
+    other->free_kid_array(other->m_kid_array);
+  }
+  other->m_num_kids = 0;
+}
+
 void Node::shift_kid() {
-  m_kids.erase(m_kids.begin());
-  if (!m_kids.empty()) {
-    m_loc = m_kids.front()->get_loc();
+  get_kids()[0]->m_adopted = false;
+  remove_kid(0);
+  if (m_num_kids > 0) {
+    m_loc = get_kids()[0]->get_loc();
     m_loc_was_set_explicitly = false;
   }
 }
+
+void Node::set_kid(unsigned index, Node *kid) {
+  if (index >= m_num_kids) {
+    throw std::out_of_range("Node::set_kid");
+  }
+  Node *&slot = get_kids()[index];
+  slot->m_adopted = false;
+  slot = kid;
+  kid->m_adopted = true;
+  note_adopted(this, kid);
+}
+
+// Store (and adopt) the initial children
+void Node::init_kids(const Node *const *kids, unsigned num_kids) {
+  Node **dest = (num_kids > INLINE_KIDS)
+    ? alloc_kid_array(get_kid_array_capacity(num_kids))
+    : m_inline_kids;
+  for (unsigned i = 0; i < num_kids; ++i) {
+    dest[i] = const_cast<Node *>(kids[i]);
+    dest[i]->m_adopted = true;
+    note_adopted(this, dest[i]);
+  }
+  if (num_kids > INLINE_KIDS) {
+    m_kid_array = dest;
+  }
+  m_num_kids = num_kids;
+}
+
+// Move children that should be deleted along with this Node to
+// the given vector. Children belonging to an arena which is being
+// cleared are omitted, since the arena will destroy them itself.
+void Node::release_kids(std::vector<Node *> &work) {
+  Node **kids = get_kids();
+  for (unsigned i = 0; i < m_num_kids; ++i) {
+    NodeArena *owner = NodeArena::get_owner(kids[i]);
+    if (owner == nullptr || !owner->is_clearing()) {
+      work.push_back(kids[i]);
+    }
+  }
+  if (m_num_kids > INLINE_KIDS) {
+    free_kid_array(m_kid_array);
+  }
+  m_num_kids = 0;
+}
+
+// Insert (and adopt) a child at the given index
+void Node::insert_kid(unsigned index, Node *kid) {
+  Node **kids = get_kids();
+  Node **dest = kids;
+
+  // switch to a larger array if necessary
+  if (m_num_kids + 1 > INLINE_KIDS
+      && (m_num_kids == INLINE_KIDS || m_num_kids + 1 > get_kid_array_capacity(m_num_kids))) {
+    dest = alloc_kid_array(get_kid_array_capacity(m_num_kids + 1));
+    memcpy(dest, kids, index * sizeof(Node *));
+  }
+
+  memmove(dest + index + 1, kids + index, (m_num_kids - index) * sizeof(Node *));
+  dest[index] = kid;
+  kid->m_adopted = true;
+  note_adopted(this, kid);
+
+  if (dest != kids) {
+    if (m_num_kids > INLINE_KIDS) {
+      free_kid_array(kids);
+    }
+    m_kid_array = dest;
+  }
+  ++m_num_kids;
+}
+
+// Remove the child at the given index (without deleting it)
+void Node::remove_kid(unsigned index) {
+  Node **kids = get_kids();
+  memmove(kids + index, kids + index + 1, (m_num_kids - index - 1) * sizeof(Node *));
+  --m_num_kids;
+
+  // move the remaining children back into the Node if they fit
+  if (m_num_kids == INLINE_KIDS) {
+    memcpy(m_inline_kids, kids, INLINE_KIDS * sizeof(Node *));
+    free_kid_array(kids);
+  }
+}
+
+// Allocate an array for pointers to children in the same
+// arena as the Node (or on the heap)
+Node **Node::alloc_kid_array(unsigned capacity) {
+  NodeArena *arena = NodeArena::get_owner(this);
+  if (arena != nullptr) {
+    return static_cast<Node **>(arena->alloc(capacity * sizeof(Node *), alignof(Node *)));
+  }
+  return static_cast<Node **>(::operator new(capacity * sizeof(Node *)));
+}
+
+void Node::free_kid_array(Node **kid_array) {
+  // arrays allocated in an arena are freed along with the arena
+  if (NodeArena::get_owner(this) == nullptr) {
+    ::operator delete(kid_array);
+  }
+}
+
+// Get the minimum capacity of the array of pointers to children
+// for a Node with the given number of children: this is the
+// smallest power of 2 that is at least the number of children
+unsigned Node::get_kid_array_capacity(unsigned num_kids) {
+  unsigned capacity = INLINE_KIDS + 1;
+  while (capacity < num_kids) {
+    capacity *= 2;
+  }
+  return capacity;
+}
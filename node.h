@@ -23,32 +23,80 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <stdexcept>
 #include "location.h"
+#include "interner.h"
 #include "node_base.h"
+#include "node_arena.h"
+
+//! Values returned by the callbacks passed to Node::traverse()
+//! to control the traversal.
+enum TraversalAction {
+  TRAVERSE_CONTINUE,   //!< continue the traversal normally
+  TRAVERSE_SKIP_KIDS,  //!< don't visit the current Node's children
+  TRAVERSE_STOP,       //!< end the traversal immediately
+};
 
 //! Tree node class, suitable for parse trees and ASTs.
 //! Nodes can also be used as tokens returned by a lexer.
 //! Note that parent nodes take responsibility for deleting
 //! their children, so to delete an entire tree, it is
 //! sufficient to delete the root.
+//!
+//! Nodes may be allocated either on the heap (using ordinary `new`)
+//! or in a NodeArena (using `new (arena) Node(...)`). A Node's
+//! children are stored in memory belonging to the same arena
+//! as the Node. Nodes must always be created using `new`. Since
+//! a Node owns nothing other than its children, clearing an arena
+//! normally doesn't need to destroy its Nodes (see NodeArena).
+//!
+//! To keep Nodes small, Node (and NodeBase) have no virtual member
+//! functions, and pointers to up to three children are stored in
+//! the Node itself. Pointers to the children of Nodes with more than
+//! three children are stored in a separate array.
 class Node : public NodeBase {
 private:
+  // Maximum number of children stored in the Node itself
+  static const unsigned INLINE_KIDS = 3;
+
   int m_tag;
-  std::vector<Node *> m_kids;
-  std::string m_str;
+  unsigned m_sym;
   Location m_loc;
+  unsigned m_num_kids;
   bool m_loc_was_set_explicitly;
+  bool m_adopted;
+
+  // If m_num_kids is greater than INLINE_KIDS, m_kid_array points
+  // to an array (allocated in the Node's arena, or on the heap)
+  // whose capacity is get_kid_array_capacity(m_num_kids) or greater
+  union {
+    Node *m_inline_kids[INLINE_KIDS];
+    Node **m_kid_array;
+  };
 
   // no value semantics
   Node(const Node &);
   Node &operator=(const Node &);
 
-  Node(int tag, const std::string &str, const std::vector<Node *> &kids);
-  Node(int tag, const std::string &str, const std::initializer_list<Node *> kids);
+  Node(int tag, unsigned sym, const std::vector<Node *> &kids);
+  Node(int tag, unsigned sym, const std::initializer_list<Node *> kids);
+
+  void init_kids(const Node *const *kids, unsigned num_kids);
+  void release_kids(std::vector<Node *> &work);
+  void insert_kid(unsigned index, Node *kid);
+  void remove_kid(unsigned index);
+  Node **alloc_kid_array(unsigned capacity);
+  void free_kid_array(Node **kid_array);
+  static unsigned get_kid_array_capacity(unsigned num_kids);
+
+  Node *const *get_kids() const { return m_num_kids > INLINE_KIDS ? m_kid_array : m_inline_kids; }
+  Node **get_kids() { return m_num_kids > INLINE_KIDS ? m_kid_array : m_inline_kids; }
 
 public:
   //! Const iterator type (for iterating through pointers to children).
-  typedef std::vector<Node *>::const_iterator const_iterator;
+  typedef Node *const *const_iterator;
 
   //! Constructor.
   //! @param tag the node tag indicating what kind of node this is
@@ -70,7 +118,22 @@ public:
   //! @param str the node's string value (e.g., the token's lexeme)
   Node(int tag, const std::string &str);
 
-  virtual ~Node();
+  ~Node();
+
+  //! Allocate memory for a Node on the heap.
+  static void *operator new(size_t size) { return NodeArena::allocate_node(size, nullptr); }
+
+  //! Allocate memory for a Node in a NodeArena.
+  //! @param arena the arena to allocate the Node in
+  //!              (if null, the Node is allocated on the heap)
+  static void *operator new(size_t size, NodeArena *arena) { return NodeArena::allocate_node(size, arena); }
+
+  //! Deallocate memory for a Node.
+  static void operator delete(void *p) { NodeArena::deallocate_node(p); }
+
+  //! Deallocate memory for a Node in a NodeArena
+  //! (called only if a Node constructor throws an exception).
+  static void operator delete(void *p, NodeArena *) { NodeArena::deallocate_node(p); }
 
   //! Get the Node's tag value.
   //! @return the Node's tag value
@@ -82,11 +145,46 @@ public:
 
   //! Get the Node's string value.
   //! @return the Node's string value
-  std::string get_str() const { return m_str; }
+  std::string get_str() const { return std::string(get_str_view()); }
+
+  //! Get the Node's string value without copying it.
+  //! The view remains valid until the Interner holding the
+  //! string is cleared (see get_interner()).
+  //! @return view of the Node's string value
+  std::string_view get_str_view() const { return get_interner().get(m_sym); }
 
-  //! Set the Node's string value.
+  //! Set the Node's string value. The string is interned.
   //! @param the string value to set
-  void set_str(const std::string &str) { m_str = str; }
+  void set_str(const std::string &str) { m_sym = get_interner().intern(str); }
+
+  //! Get the Interner holding the Node's string value: the Interner
+  //! of the Node's arena, or the global Interner if the Node is
+  //! allocated on the heap or its arena has no Interner.
+  //! @return the Interner holding the Node's string value
+  Interner &get_interner() const {
+    NodeArena *arena = NodeArena::get_owner(this);
+    Interner *interner = (arena != nullptr) ? arena->get_interner() : nullptr;
+    return (interner != nullptr) ? *interner : Interner::get_global();
+  }
+
+  //! Get the symbol id of the Node's string value (see Interner).
+  //! Two Nodes using the same Interner whose string values were
+  //! interned (e.g., identifiers) have equal string values if and
+  //! only if their symbol ids are equal.
+  //! @return the symbol id of the Node's string value
+  unsigned get_sym() const { return m_sym; }
+
+  //! Set the Node's string value using a symbol id (see Interner).
+  //! @param sym the symbol id of the string value to set, which must
+  //!            belong to the Node's Interner (see get_interner())
+  void set_sym(unsigned sym) { m_sym = sym; }
+
+  //! Check whether this Node has been adopted as the child of
+  //! another Node. A Node is no longer considered to be adopted
+  //! after it is removed from its parent using shift_kid()
+  //! or set_kid().
+  //! @return true if the Node has a parent, false otherwise
+  bool is_adopted() const { return m_adopted; }
 
   //! Append and adopt a child Node.
   //! @param the child Node to append and adopt
@@ -96,18 +194,28 @@ public:
   //! @param the child Node to prepend and adopt
   void prepend_kid(Node *kid);
 
+  //! Remove all of the children of another Node, and append
+  //! (and adopt) them, in order.
+  //! @param other the Node whose children should be moved to this Node
+  void append_kids_from(Node *other);
+
   //! Get number of children.
   //! @return the number of children
-  unsigned get_num_kids() const { return unsigned(m_kids.size()); }
+  unsigned get_num_kids() const { return m_num_kids; }
 
   //! Get child at given index.
   //! @param index the index of the child to get (0 for first child, etc.)
   //! @return pointer to the child at given index
-  Node *get_kid(unsigned index) const { return m_kids.at(index); }
+  Node *get_kid(unsigned index) const {
+    if (index >= m_num_kids) {
+      throw std::out_of_range("Node::get_kid");
+    }
+    return get_kids()[index];
+  }
 
   //! Get the last (righmost) child.
   //! @return poiner to the last (rightmost) child
-  Node *get_last_kid() const { return m_kids.back(); }
+  Node *get_last_kid() const { return get_kids()[m_num_kids - 1]; }
 
   //! Remove the first child.
   //! Note that the discarded child is *not* deleted,
@@ -124,15 +232,15 @@ public:
   //!
   //! @param index the index of the child to get (0 for first child, etc.)
   //! @param kid the child Node to adopt and place at specified index
-  void set_kid(unsigned index, Node *kid) { m_kids.at(index) = kid; }
+  void set_kid(unsigned index, Node *kid);
 
   //! Get begin iterator over pointers to children.
   //! @return begin iterator
-  const_iterator cbegin() const { return m_kids.cbegin(); }
+  const_iterator cbegin() const { return get_kids(); }
 
   //! Get end iterator over pointers to children.
   //! @return end iterator
-  const_iterator cend() const { return m_kids.cend(); }
+  const_iterator cend() const { return get_kids() + m_num_kids; }
 
   //! Set this Node's source Location.
   //! @param loc the source Location to set
@@ -142,16 +250,59 @@ public:
   //! @return the source Location
   const Location &get_loc() const { return m_loc; }
 
+  //! Check whether the source Location was set explicitly (using
+  //! set_loc()), rather than being taken from the first child.
+  //! @return true if the source Location was set explicitly
+  bool is_loc_set_explicitly() const { return m_loc_was_set_explicitly; }
+
+  //! Set this Node's source Location (which may be invalid), and
+  //! whether it was set explicitly. This is used to restore a Node
+  //! exactly as it was (e.g., when reading a serialized tree), since
+  //! appending children can change the Location.
+  //! @param loc the source Location
+  //! @param explicitly true if the source Location was set explicitly
+  void restore_loc(const Location &loc, bool explicitly) {
+    m_loc = loc;
+    m_loc_was_set_explicitly = explicitly;
+  }
+
+  //! Traverse the tree rooted at this Node, invoking one callback
+  //! when each Node is entered (before its children are visited)
+  //! and another when each Node is left (after its children are
+  //! visited), i.e., an Euler tour of the tree. Both callbacks are
+  //! called as `fn(n, depth)`, where `depth` is 0 for this Node,
+  //! 1 for its children, etc., and return a TraversalAction.
+  //! The traversal uses an explicit stack rather than recursion,
+  //! so the depth of the tree is limited only by available memory.
+  //! @tparam Enter type of the function called when a Node is entered
+  //! @tparam Leave type of the function called when a Node is left
+  //! @param enter function called when a Node is entered
+  //!              (returning TRAVERSE_SKIP_KIDS causes the Node's
+  //!              children to be skipped, although the Node is still left)
+  //! @param leave function called when a Node is left
+  //! @return true if the traversal completed, false if it
+  //!         was stopped by a callback returning TRAVERSE_STOP
+  template<typename Enter, typename Leave>
+  bool traverse(Enter enter, Leave leave);
+
   //! Do a preorder traversal of the tree, invoking specified
   //! function on each node.
   //! @tparam Fn function type
   //! @param fn the function to apply to each tree Node in preorder
   template<typename Fn>
   void preorder(Fn fn) {
-    fn(this);
-    for (auto i = m_kids.begin(); i != m_kids.end(); ++i) {
-      (*i)->preorder(fn);
-    }
+    traverse([&fn](Node *n, unsigned) { fn(n); return TRAVERSE_CONTINUE; },
+             [](Node *, unsigned) { return TRAVERSE_CONTINUE; });
+  }
+
+  //! Do a postorder traversal of the tree, invoking specified
+  //! function on each node.
+  //! @tparam Fn function type
+  //! @param fn the function to apply to each tree Node in postorder
+  template<typename Fn>
+  void postorder(Fn fn) {
+    traverse([](Node *, unsigned) { return TRAVERSE_CONTINUE; },
+             [&fn](Node *n, unsigned) { fn(n); return TRAVERSE_CONTINUE; });
   }
 
   //! Invoke a function on each child.
@@ -159,10 +310,49 @@ public:
   //! @param fn the function to apply to each child
   template<typename Fn>
   void each_child(Fn fn) const {
-    for (auto i = m_kids.begin(); i != m_kids.end(); ++i) {
+    for (auto i = cbegin(); i != cend(); ++i) {
       fn(*i);
     }
   }
 };
 
+template<typename Enter, typename Leave>
+bool Node::traverse(Enter enter, Leave leave) {
+  // Each stack entry is a Node whose children are being visited,
+  // and the index of the next child to visit
+  std::vector<std::pair<Node *, unsigned>> stack;
+
+  Node *n = this;
+  for (;;) {
+    unsigned depth = unsigned(stack.size());
+    TraversalAction action = enter(n, depth);
+    if (action == TRAVERSE_STOP) {
+      return false;
+    }
+    if (action == TRAVERSE_CONTINUE && n->m_num_kids > 0) {
+      stack.push_back({ n, 0 });
+    } else if (leave(n, depth) == TRAVERSE_STOP) {
+      return false;
+    }
+
+    // Find the next Node to enter, leaving each Node
+    // whose children have all been visited
+    for (;;) {
+      if (stack.empty()) {
+        return true;
+      }
+      std::pair<Node *, unsigned> &top = stack.back();
+      if (top.second < top.first->m_num_kids) {
+        n = top.first->get_kids()[top.second++];
+        break;
+      }
+      Node *done = top.first;
+      stack.pop_back();
+      if (leave(done, unsigned(stack.size())) == TRAVERSE_STOP) {
+        return false;
+      }
+    }
+  }
+}
+
 #endif // NODE_H
@@ -0,0 +1,245 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cassert>
+#include <new>
+#include <algorithm>
+#include "node.h"
+#include "node_arena.h"
+
+namespace {
+
+// The header word preceding each Node is 0 if the Node was allocated
+// on the heap, otherwise it is the address of the owning NodeArena.
+// For Nodes in an arena, the low bit of the header is set once
+// the Node has been destroyed.
+const uintptr_t DEAD = 1;
+
+const size_t HEADER_SIZE = std::max(sizeof(uintptr_t), alignof(Node));
+
+// Each Node slot in an arena consists of a header and the Node
+const size_t SLOT_SIZE =
+  (HEADER_SIZE + sizeof(Node) + alignof(Node) - 1) & ~(alignof(Node) - 1);
+
+const size_t SLOTS_PER_BLOCK = 4096;
+
+// Minimum size of a block of memory for arrays
+const size_t MIN_BYTE_BLOCK_SIZE = 64 * 1024;
+
+uintptr_t &header_of(const void *p) {
+  return *reinterpret_cast<uintptr_t *>(const_cast<char *>(static_cast<const char *>(p)) - HEADER_SIZE);
+}
+
+char *alloc_block(size_t size) {
+  char *data = static_cast<char *>(malloc(size));
+  if (data == nullptr) {
+    throw std::bad_alloc();
+  }
+  return data;
+}
+
+}
+
+NodeArena::NodeArena()
+  : m_num_node_blocks_used(0)
+  , m_num_slots_used(0)
+  , m_num_byte_blocks_used(0)
+  , m_byte_pos(nullptr)
+  , m_byte_end(nullptr)
+  , m_num_nodes(0)
+  , m_bytes_allocated(0)
+  , m_clearing(false)
+  , m_has_heap_kids(false)
+  , m_interner(nullptr) {
+}
+
+NodeArena::~NodeArena() {
+  clear();
+  release();
+}
+
+void *NodeArena::alloc(size_t size, size_t align) {
+  uintptr_t pos = (reinterpret_cast<uintptr_t>(m_byte_pos) + align - 1) & ~uintptr_t(align - 1);
+  if (m_byte_pos == nullptr || pos + size > reinterpret_cast<uintptr_t>(m_byte_end)) {
+    return alloc_from_new_byte_block(size, align);
+  }
+  m_byte_pos = reinterpret_cast<char *>(pos + size);
+  m_bytes_allocated += size;
+  return reinterpret_cast<void *>(pos);
+}
+
+void NodeArena::clear() {
+  m_clearing = true;
+  sweep();
+  m_clearing = false;
+}
+
+void NodeArena::clear(const std::vector<NodeArena *> &arenas) {
+  for (auto i = arenas.begin(); i != arenas.end(); ++i) {
+    (*i)->m_clearing = true;
+  }
+  for (auto i = arenas.begin(); i != arenas.end(); ++i) {
+    (*i)->sweep();
+  }
+  for (auto i = arenas.begin(); i != arenas.end(); ++i) {
+    (*i)->m_clearing = false;
+  }
+}
+
+// Reset the arena. Destroying a Node only matters if it has children
+// which aren't in an arena, so unless a Node in this arena adopted a
+// Node allocated on the heap, the Nodes are simply abandoned. Otherwise,
+// the live Nodes are destroyed by sweeping through the Node slots in
+// allocation order. Because m_clearing is set, Node destructors won't
+// try to delete children belonging to this arena.
+void NodeArena::sweep() {
+  if (m_has_heap_kids) {
+    each_live_node([](Node *n) {
+      n->~Node();
+      header_of(n) |= DEAD;
+    });
+    m_has_heap_kids = false;
+  }
+
+  // Keep the blocks for reuse
+  m_num_node_blocks_used = 0;
+  m_num_slots_used = 0;
+  m_num_byte_blocks_used = 0;
+  m_byte_pos = m_byte_end = nullptr;
+  m_num_nodes = 0;
+  m_bytes_allocated = 0;
+}
+
+size_t NodeArena::delete_unadopted(const Node *root) {
+  if (!m_has_heap_kids) {
+    return 0;
+  }
+
+  size_t count = 0;
+  each_live_node([root, &count](Node *n) {
+    if (n != root && !n->is_adopted()) {
+      delete n;
+      ++count;
+    }
+  });
+  return count;
+}
+
+void *NodeArena::allocate_node(size_t size, NodeArena *arena) {
+  if (arena != nullptr) {
+    assert(size <= sizeof(Node));
+    return arena->alloc_node_slot();
+  }
+
+  char *p = static_cast<char *>(malloc(HEADER_SIZE + size));
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<uintptr_t *>(p) = 0;
+  return p + HEADER_SIZE;
+}
+
+void NodeArena::deallocate_node(void *p) {
+  if (p == nullptr) {
+    return;
+  }
+  uintptr_t &header = header_of(p);
+  if (header == 0) {
+    free(static_cast<char *>(p) - HEADER_SIZE);
+  } else {
+    // the memory belongs to the arena, so just note that
+    // the Node no longer needs to be destroyed
+    header |= DEAD;
+  }
+}
+
+NodeArena *NodeArena::get_owner(const void *p) {
+  return reinterpret_cast<NodeArena *>(header_of(p) & ~DEAD);
+}
+
+// Invoke a function on each Node in the arena which hasn't been
+// destroyed, in allocation order. The function may destroy Nodes.
+template<typename Fn>
+void NodeArena::each_live_node(Fn fn) {
+  for (size_t i = 0; i < m_num_node_blocks_used; ++i) {
+    size_t num_slots = (i + 1 == m_num_node_blocks_used) ? m_num_slots_used : SLOTS_PER_BLOCK;
+    char *slot = m_node_blocks[i].data;
+    for (size_t j = 0; j < num_slots; ++j, slot += SLOT_SIZE) {
+      Node *n = reinterpret_cast<Node *>(slot + HEADER_SIZE);
+      if ((header_of(n) & DEAD) == 0) {
+        fn(n);
+      }
+    }
+  }
+}
+
+void *NodeArena::alloc_node_slot() {
+  if (m_num_node_blocks_used == 0 || m_num_slots_used == SLOTS_PER_BLOCK) {
+    if (m_num_node_blocks_used == m_node_blocks.size()) {
+      m_node_blocks.push_back({ alloc_block(SLOTS_PER_BLOCK * SLOT_SIZE), SLOTS_PER_BLOCK * SLOT_SIZE });
+    }
+    ++m_num_node_blocks_used;
+    m_num_slots_used = 0;
+  }
+
+  char *slot = m_node_blocks[m_num_node_blocks_used - 1].data + m_num_slots_used * SLOT_SIZE;
+  ++m_num_slots_used;
+  ++m_num_nodes;
+  m_bytes_allocated += SLOT_SIZE;
+
+  *reinterpret_cast<uintptr_t *>(slot) = reinterpret_cast<uintptr_t>(this);
+  return slot + HEADER_SIZE;
+}
+
+void *NodeArena::alloc_from_new_byte_block(size_t size, size_t align) {
+  size_t needed = size + align;
+
+  // Reuse a retained block if it is large enough, otherwise
+  // allocate a new one (and put it in the place of the one
+  // that was too small)
+  if (m_num_byte_blocks_used < m_byte_blocks.size()
+      && m_byte_blocks[m_num_byte_blocks_used].size < needed) {
+    Block small = m_byte_blocks[m_num_byte_blocks_used];
+    size_t block_size = std::max(needed, MIN_BYTE_BLOCK_SIZE);
+    m_byte_blocks[m_num_byte_blocks_used] = { alloc_block(block_size), block_size };
+    m_byte_blocks.push_back(small);
+  } else if (m_num_byte_blocks_used == m_byte_blocks.size()) {
+    size_t block_size = std::max(needed, MIN_BYTE_BLOCK_SIZE);
+    m_byte_blocks.push_back({ alloc_block(block_size), block_size });
+  }
+
+  Block &block = m_byte_blocks[m_num_byte_blocks_used++];
+  m_byte_pos = block.data;
+  m_byte_end = block.data + block.size;
+  return alloc(size, align);
+}
+
+void NodeArena::release() {
+  for (auto i = m_node_blocks.begin(); i != m_node_blocks.end(); ++i) {
+    free(i->data);
+  }
+  for (auto i = m_byte_blocks.begin(); i != m_byte_blocks.end(); ++i) {
+    free(i->data);
+  }
+  m_node_blocks.clear();
+  m_byte_blocks.clear();
+}
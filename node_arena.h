@@ -0,0 +1,177 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <vector>
+#include <cstddef>
+class Node;
+class Interner;
+
+//! A NodeArena is a bump allocator for tree Nodes and their child
+//! arrays. Nodes are allocated in the arena using placement new, e.g.
+//!
+//!     Node *n = new (arena) Node(AST_UNIT);
+//!
+//! where `arena` is a pointer to a NodeArena (if it is null, the Node
+//! is allocated on the heap.) The arena owns the memory of its Nodes:
+//! deleting a Node allocated in an arena runs its destructor, but the
+//! memory isn't released until the arena is cleared or destroyed.
+//! Clearing the arena doesn't visit its Nodes at all: since a Node owns
+//! nothing but its children (and its array of pointers to them, which
+//! is in the arena), the arena just resets its allocation position, and
+//! keeps its memory blocks so they can be reused, e.g., for the next
+//! parse. The only exception is an arena in which a Node has adopted a
+//! Node allocated on the heap: then clearing the arena destroys its
+//! remaining Nodes (which deletes those children) in a single linear
+//! pass over the arena's Nodes.
+//!
+//! Every Node, whether allocated in an arena or on the heap, is preceded
+//! by a header word identifying who owns its memory, which is how
+//! `delete` knows what to do with it. For this reason, Nodes must
+//! always be created using `new`.
+//!
+//! A NodeArena can have an Interner (see set_interner()), which
+//! is used for the string values of the Nodes allocated in it.
+//!
+//! A NodeArena may only be used from one thread at a time.
+class NodeArena {
+private:
+  struct Block {
+    char *data;
+    size_t size;
+  };
+
+  std::vector<Block> m_node_blocks;
+  size_t m_num_node_blocks_used;
+  size_t m_num_slots_used; // in the current node block
+  std::vector<Block> m_byte_blocks;
+  size_t m_num_byte_blocks_used;
+  char *m_byte_pos, *m_byte_end;
+  size_t m_num_nodes;
+  size_t m_bytes_allocated;
+  bool m_clearing;
+  bool m_has_heap_kids; // a Node in the arena adopted a heap-allocated Node
+  Interner *m_interner;
+
+  // copy ctor and assignment operator not allowed
+  NodeArena(const NodeArena &);
+  NodeArena &operator=(const NodeArena &);
+
+public:
+  NodeArena();
+
+  //! Destructor. Destroys all Nodes remaining in the arena
+  //! and releases its memory.
+  ~NodeArena();
+
+  //! Allocate memory for an array (e.g., of pointers to child Nodes.)
+  //! The memory is released when the arena is cleared or destroyed.
+  //! @param size number of bytes to allocate
+  //! @param align required alignment
+  //! @return pointer to the allocated memory
+  void *alloc(size_t size, size_t align);
+
+  //! Destroy all Nodes remaining in the arena. The arena's memory
+  //! blocks are retained, and will be used for subsequent allocations.
+  //! Nodes which aren't in the arena must not refer to its Nodes
+  //! once it is cleared.
+  void clear();
+
+  //! Clear several arenas at once. This must be used (rather than
+  //! clearing the arenas one at a time) if Nodes in one of the
+  //! arenas could have children in another.
+  //! @param arenas the arenas to clear
+  static void clear(const std::vector<NodeArena *> &arenas);
+
+  //! Delete every Node remaining in the arena which has not been
+  //! adopted by a parent Node (see Node::is_adopted()), other than
+  //! the specified root. This is done in a single linear pass over
+  //! the arena's Nodes (deleting an unadopted Node also deletes its
+  //! descendants.) Note that the memory used by the deleted Nodes
+  //! isn't reclaimed until the arena is cleared. Unless a Node in the
+  //! arena has adopted a Node allocated on the heap, deleting the
+  //! unadopted Nodes would accomplish nothing (see clear()), so nothing
+  //! is done.
+  //! @param root the root of the tree to keep (may be null)
+  //! @return the number of unadopted Nodes deleted
+  size_t delete_unadopted(const Node *root);
+
+  //! Note that a Node in the arena has adopted a Node allocated
+  //! on the heap (called by Node), so the arena's Nodes must be
+  //! destroyed when it is cleared.
+  void note_heap_kid() { m_has_heap_kids = true; }
+
+  //! Check whether the arena is in the process of being cleared.
+  //! While this is the case, a Node's destructor should not delete
+  //! child Nodes belonging to the arena, since the arena will
+  //! destroy them itself.
+  //! @return true if the arena is being cleared, false otherwise
+  bool is_clearing() const { return m_clearing; }
+
+  //! Set the Interner used for the string values of Nodes allocated
+  //! in the arena. The Interner must not be cleared while the arena
+  //! has Nodes referring to its strings.
+  //! @param interner the Interner (if null, the global Interner is used)
+  void set_interner(Interner *interner) { m_interner = interner; }
+
+  //! Get the Interner used for the string values of Nodes allocated
+  //! in the arena.
+  //! @return the Interner, or null if the global Interner is used
+  Interner *get_interner() const { return m_interner; }
+
+  //! Get the number of Nodes allocated since the arena was
+  //! last cleared.
+  //! @return the number of Nodes allocated
+  size_t get_num_nodes() const { return m_num_nodes; }
+
+  //! Get the number of bytes (for Nodes and arrays) allocated
+  //! since the arena was last cleared.
+  //! @return the number of bytes allocated
+  size_t get_bytes_allocated() const { return m_bytes_allocated; }
+
+  //! Allocate memory for a Node (used by Node's `operator new`).
+  //! @param size the size of the Node
+  //! @param arena the arena to allocate the Node in, or null
+  //!              to allocate the Node on the heap
+  //! @return pointer to memory for the Node
+  static void *allocate_node(size_t size, NodeArena *arena);
+
+  //! Deallocate memory for a Node (used by Node's `operator delete`).
+  //! @param p pointer to the Node's memory (its destructor must
+  //!          already have been run)
+  static void deallocate_node(void *p);
+
+  //! Get the arena owning the memory of a Node.
+  //! @param p pointer to the Node
+  //! @return the arena owning the Node's memory, or null if
+  //!         the Node was allocated on the heap
+  static NodeArena *get_owner(const void *p);
+
+private:
+  template<typename Fn> void each_live_node(Fn fn);
+  void sweep();
+  void *alloc_node_slot();
+  void *alloc_from_new_byte_block(size_t size, size_t align);
+  void release();
+};
+
+#endif // NODE_ARENA_H
@@ -35,7 +35,9 @@ private:
 
 public:
   NodeBase();
-  virtual ~NodeBase();  
+  // Note that the destructor isn't virtual: Node doesn't have
+  // any virtual member functions, which keeps Nodes small
+  ~NodeBase();
 };
 
 #endif // NODE_BASE_H
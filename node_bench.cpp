@@ -0,0 +1,127 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Microbenchmark for the size of Nodes and the cost of creating them.
+// The size of a Node, and the number of bytes a NodeArena uses for each
+// one, are reported. Then many small subtrees (a Node with three
+// children, which are stored in the Node itself) and a few wide ones
+// (a Node with many children, which need a separate array) are created,
+// both in a NodeArena and on the heap, and the number of Nodes created
+// per second is measured.
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <vector>
+#include "node.h"
+#include "node_arena.h"
+#include "grammar_symbols.h"
+
+namespace {
+
+// Number of times each operation is done (the fastest time is used)
+const unsigned NUM_RUNS = 5;
+
+// Number of small subtrees created in each run
+const unsigned NUM_SUBTREES = 1000000;
+
+// Number of children of the wide subtrees, and how many are created
+const unsigned WIDE_KIDS = 64;
+const unsigned NUM_WIDE = NUM_SUBTREES * 4 / (WIDE_KIDS + 1);
+
+// Time a function, returning the elapsed time in milliseconds
+double time_ms(const std::function<void()> &fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::milli> elapsed = end - start;
+  return elapsed.count();
+}
+
+// Record the fastest time for an operation
+void record(double &best, unsigned run, double ms) {
+  best = (run == 0) ? ms : std::min(best, ms);
+}
+
+// Create a subtree consisting of a Node with the specified
+// number of children
+Node *make_subtree(NodeArena *arena, unsigned num_kids) {
+  Node *n = new (arena) Node(NODE_TOK_IDENT);
+  for (unsigned i = 0; i < num_kids; ++i) {
+    n->append_kid(new (arena) Node(NODE_TOK_IDENT));
+  }
+  return n;
+}
+
+// Create subtrees (in an arena, or on the heap if arena is null),
+// and then destroy them, returning the time spent creating them
+double time_subtrees(NodeArena *arena, unsigned count, unsigned num_kids) {
+  std::vector<Node *> roots(count);
+  double ms = time_ms([&]() {
+    for (unsigned i = 0; i < count; ++i) {
+      roots[i] = make_subtree(arena, num_kids);
+    }
+  });
+  if (arena != nullptr) {
+    arena->clear();
+  } else {
+    for (auto i = roots.begin(); i != roots.end(); ++i) {
+      delete *i;
+    }
+  }
+  return ms;
+}
+
+// Print the rate at which Nodes were created
+void print_rate(const char *what, double ms, unsigned num_nodes) {
+  printf("  %-24s%8.1f ms (%.1fM nodes/s)\n", what, ms, num_nodes / ms / 1000.0);
+}
+
+}
+
+int main() {
+  NodeArena arena;
+
+  // Measure the arena's memory per Node: small subtrees have
+  // no child arrays, so all of the memory is for Node slots
+  delete make_subtree(&arena, 3);
+  size_t bytes_per_node = arena.get_bytes_allocated() / arena.get_num_nodes();
+  arena.clear();
+
+  double arena_small = 0, heap_small = 0, arena_wide = 0, heap_wide = 0;
+  for (unsigned i = 0; i < NUM_RUNS; ++i) {
+    record(arena_small, i, time_subtrees(&arena, NUM_SUBTREES, 3));
+    record(heap_small, i, time_subtrees(nullptr, NUM_SUBTREES, 3));
+    record(arena_wide, i, time_subtrees(&arena, NUM_WIDE, WIDE_KIDS));
+    record(heap_wide, i, time_subtrees(nullptr, NUM_WIDE, WIDE_KIDS));
+  }
+
+  unsigned small_nodes = NUM_SUBTREES * 4, wide_nodes = NUM_WIDE * (WIDE_KIDS + 1);
+  printf("sizeof(Node): %zu bytes (%zu bytes per Node in a NodeArena)\n", sizeof(Node), bytes_per_node);
+  printf("%u subtrees with 3 children:\n", NUM_SUBTREES);
+  print_rate("NodeArena:", arena_small, small_nodes);
+  print_rate("heap:", heap_small, small_nodes);
+  printf("%u subtrees with %u children:\n", NUM_WIDE, WIDE_KIDS);
+  print_rate("NodeArena:", arena_wide, wide_nodes);
+  print_rate("heap:", heap_wide, wide_nodes);
+  return 0;
+}
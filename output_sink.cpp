@@ -0,0 +1,141 @@
+// Copyright (c) 2021-2022, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+#include "exceptions.h"
+#include "output_sink.h"
+
+OutputSink::OutputSink(int fd, size_t capacity)
+  : m_buf(capacity)
+  , m_size(0)
+  , m_fd(fd)
+  , m_file(nullptr)
+  , m_str(nullptr) {
+}
+
+OutputSink::OutputSink(FILE *out, size_t capacity)
+  : m_buf(capacity)
+  , m_size(0)
+  , m_fd(-1)
+  , m_file(out)
+  , m_str(nullptr) {
+}
+
+OutputSink::OutputSink(std::string &out, size_t capacity)
+  : m_buf(capacity)
+  , m_size(0)
+  , m_fd(-1)
+  , m_file(nullptr)
+  , m_str(&out) {
+}
+
+OutputSink::~OutputSink() {
+  try {
+    flush();
+  } catch (BaseException &ex) {
+    // nothing can be done about it now
+  }
+}
+
+void OutputSink::append(char c, size_t count) {
+  while (count > 0) {
+    if (m_size == m_buf.size()) {
+      flush_buffer();
+    }
+    size_t n = std::min(count, m_buf.size() - m_size);
+    std::fill_n(m_buf.data() + m_size, n, c);
+    m_size += n;
+    count -= n;
+  }
+}
+
+void OutputSink::append_uint(unsigned long value) {
+  // generate the digits backwards
+  char digits[24];
+  char *p = digits + sizeof(digits);
+  do {
+    *--p = char('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  append(std::string_view(p, size_t(digits + sizeof(digits) - p)));
+}
+
+void OutputSink::append_int(long value) {
+  if (value < 0) {
+    append('-');
+    // negate as unsigned, so the most negative value works
+    append_uint(0UL - static_cast<unsigned long>(value));
+  } else {
+    append_uint(static_cast<unsigned long>(value));
+  }
+}
+
+void OutputSink::flush() {
+  flush_buffer();
+  if (m_file != nullptr && fflush(m_file) != 0) {
+    RuntimeError::raise("Couldn't write output");
+  }
+}
+
+void OutputSink::append_slow(std::string_view str) {
+  flush_buffer();
+  if (str.size() >= m_buf.size()) {
+    // too big to buffer
+    write_out(str.data(), str.size());
+  } else {
+    str.copy(m_buf.data(), str.size());
+    m_size = str.size();
+  }
+}
+
+void OutputSink::flush_buffer() {
+  // reset the buffer first, so that if writing fails,
+  // the output isn't written again by the destructor
+  size_t size = m_size;
+  m_size = 0;
+  write_out(m_buf.data(), size);
+}
+
+void OutputSink::write_out(const char *data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  if (m_str != nullptr) {
+    m_str->append(data, size);
+  } else if (m_file != nullptr) {
+    if (fwrite(data, 1, size, m_file) != size) {
+      RuntimeError::raise("Couldn't write output");
+    }
+  } else {
+    while (size > 0) {
+      ssize_t n = write(m_fd, data, size);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        RuntimeError::raise("Couldn't write output");
+      }
+      data += n;
+      size -= size_t(n);
+    }
+  }
+}
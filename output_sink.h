@@ -0,0 +1,115 @@
+// Copyright (c) 2021-2022, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+
+//! An OutputSink collects output in a large buffer, which is written
+//! to its destination (a file descriptor, a FILE, or a string) only
+//! when it fills up, when flush() is called, or when the OutputSink
+//! is destroyed. This avoids the overhead of a stdio call (and of
+//! parsing a format string) for each small piece of output.
+class OutputSink {
+private:
+  std::vector<char> m_buf;
+  size_t m_size;
+  int m_fd;
+  FILE *m_file;
+  std::string *m_str;
+
+  // copy ctor and assignment operator not allowed
+  OutputSink(const OutputSink &);
+  OutputSink &operator=(const OutputSink &);
+
+public:
+  //! Default size of the buffer.
+  static const size_t DEFAULT_CAPACITY = 65536;
+
+  //! Constructor for writing to a file descriptor (using write(2).)
+  //! If the file descriptor is also used by a FILE (e.g., stdout),
+  //! the FILE should be flushed first.
+  //! @param fd the file descriptor
+  //! @param capacity the size of the buffer
+  explicit OutputSink(int fd, size_t capacity = DEFAULT_CAPACITY);
+
+  //! Constructor for writing to a FILE. Buffered output is written
+  //! using fwrite(), so it stays in order with other output to the FILE.
+  //! @param out the FILE
+  //! @param capacity the size of the buffer
+  explicit OutputSink(FILE *out, size_t capacity = DEFAULT_CAPACITY);
+
+  //! Constructor for appending to a string.
+  //! @param out the string
+  //! @param capacity the size of the buffer
+  explicit OutputSink(std::string &out, size_t capacity = DEFAULT_CAPACITY);
+
+  //! Destructor. Flushes the buffer (but errors are ignored,
+  //! so call flush() first to check for errors.)
+  ~OutputSink();
+
+  //! Append a string.
+  //! @param str the string
+  void append(std::string_view str) {
+    if (str.size() > m_buf.size() - m_size) {
+      append_slow(str);
+    } else {
+      str.copy(m_buf.data() + m_size, str.size());
+      m_size += str.size();
+    }
+  }
+
+  //! Append a character.
+  //! @param c the character
+  void append(char c) {
+    if (m_size == m_buf.size()) {
+      flush_buffer();
+    }
+    m_buf[m_size++] = c;
+  }
+
+  //! Append a character repeatedly.
+  //! @param c the character
+  //! @param count the number of times to append it
+  void append(char c, size_t count);
+
+  //! Append an unsigned integer in decimal.
+  //! @param value the integer
+  void append_uint(unsigned long value);
+
+  //! Append a signed integer in decimal.
+  //! @param value the integer
+  void append_int(long value);
+
+  //! Write all buffered output to the destination.
+  //! Throws RuntimeError if the output can't be written.
+  void flush();
+
+private:
+  void append_slow(std::string_view str);
+  void flush_buffer();
+  void write_out(const char *data, size_t size);
+};
+
+#endif // OUTPUT_SINK_H
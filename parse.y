@@ -27,14 +27,22 @@
 #include "grammar_symbols.h"
 #include "yyerror.h"
 
-// This is a weird hack required to make bison pass the
-// yyscan_t value representing the scanner state (which is
-// stored in the ParserState object) to yylex()
-#define the_scanner pp->scan_info
-
-// Bison does not actually declare yylex()
-typedef union YYSTYPE YYSTYPE;
-int yylex(YYSTYPE *, void *);
+// The parser doesn't call the flex-generated yylex() directly:
+// instead, next_token() (see parser_state.cpp) reads tokens from
+// the ParserState's token table, running the lexer as needed
+#define yylex next_token
+
+// The semantic value of a token is its index in the token table,
+// so a Node representing the token must be created when the
+// token is incorporated into the tree
+#define TOKNODE(index) pp->get_token_node(index)
+
+// The rules for lists (including the unit, i.e., the list of top-level
+// declarations) are right-recursive, since that is the shape of the
+// parse tree, so the parser's stack grows with the length of a list.
+// Bison's default limit (10000) would reject inputs with more than
+// a few thousand top-level declarations.
+#define YYMAXDEPTH 10000000
 %}
 
 %define api.pure
@@ -46,12 +54,10 @@ int yylex(YYSTYPE *, void *);
 %parse-param { struct ParserState *pp }
 
   /*
-   * Note that lex-param only controls the actual argument to yylex,
-   * and can only consist of a single token (hence the need to make
-   * it a #define so the lexer state can be accessed within the
-   * ParserState object
+   * The ParserState is also passed to next_token(), since it
+   * has the token table and lexer state
    */
-%lex-param { the_scanner }
+%lex-param { pp }
 
   /*
    * We expect one shift/reduce conflict due to the "dangling else" problem.
@@ -60,36 +66,42 @@ int yylex(YYSTYPE *, void *);
    */
 %expect 1
 
+  /*
+   * Make sure the Node type is declared wherever parse.tab.h is included
+   */
+%code requires { class Node; }
+
 %union {
   Node *node;
+  unsigned tok;
 }
 
-%token<node> TOK_LPAREN TOK_RPAREN TOK_LBRACKET TOK_RBRACKET TOK_LBRACE TOK_RBRACE
-%token<node> TOK_SEMICOLON TOK_COLON
-%token<node> TOK_COMMA TOK_DOT TOK_QUESTION TOK_NOT
-%token<node> TOK_ARROW
+%token<tok> TOK_LPAREN TOK_RPAREN TOK_LBRACKET TOK_RBRACKET TOK_LBRACE TOK_RBRACE
+%token<tok> TOK_SEMICOLON TOK_COLON
+%token<tok> TOK_COMMA TOK_DOT TOK_QUESTION TOK_NOT
+%token<tok> TOK_ARROW
 
-%token<node> TOK_PLUS TOK_INCREMENT TOK_MINUS TOK_DECREMENT
-%token<node> TOK_ASTERISK TOK_DIVIDE TOK_MOD
+%token<tok> TOK_PLUS TOK_INCREMENT TOK_MINUS TOK_DECREMENT
+%token<tok> TOK_ASTERISK TOK_DIVIDE TOK_MOD
 
-%token<node> TOK_AMPERSAND TOK_BITWISE_OR TOK_BITWISE_XOR TOK_BITWISE_COMPL
-%token<node> TOK_LEFT_SHIFT TOK_RIGHT_SHIFT
+%token<tok> TOK_AMPERSAND TOK_BITWISE_OR TOK_BITWISE_XOR TOK_BITWISE_COMPL
+%token<tok> TOK_LEFT_SHIFT TOK_RIGHT_SHIFT
 
-%token<node> TOK_LOGICAL_AND TOK_LOGICAL_OR
+%token<tok> TOK_LOGICAL_AND TOK_LOGICAL_OR
 
-%token<node> TOK_EQUALITY TOK_INEQUALITY TOK_LT TOK_LTE TOK_GT TOK_GTE
+%token<tok> TOK_EQUALITY TOK_INEQUALITY TOK_LT TOK_LTE TOK_GT TOK_GTE
 
-%token<node> TOK_ASSIGN TOK_MUL_ASSIGN TOK_DIV_ASSIGN TOK_MOD_ASSIGN TOK_ADD_ASSIGN
-%token<node> TOK_SUB_ASSIGN TOK_LEFT_ASSIGN TOK_RIGHT_ASSIGN TOK_AND_ASSIGN TOK_XOR_ASSIGN
-%token<node> TOK_OR_ASSIGN
+%token<tok> TOK_ASSIGN TOK_MUL_ASSIGN TOK_DIV_ASSIGN TOK_MOD_ASSIGN TOK_ADD_ASSIGN
+%token<tok> TOK_SUB_ASSIGN TOK_LEFT_ASSIGN TOK_RIGHT_ASSIGN TOK_AND_ASSIGN TOK_XOR_ASSIGN
+%token<tok> TOK_OR_ASSIGN
 
-%token<node> TOK_IF TOK_ELSE TOK_WHILE TOK_FOR TOK_DO TOK_SWITCH TOK_CASE
-%token<node> TOK_CHAR TOK_SHORT TOK_INT TOK_LONG TOK_UNSIGNED TOK_SIGNED
-%token<node> TOK_FLOAT TOK_DOUBLE
-%token<node> TOK_VOID
-%token<node> TOK_RETURN TOK_BREAK TOK_CONTINUE
-%token<node> TOK_CONST TOK_VOLATILE
-%token<node> TOK_STRUCT TOK_UNION
+%token<tok> TOK_IF TOK_ELSE TOK_WHILE TOK_FOR TOK_DO TOK_SWITCH TOK_CASE
+%token<tok> TOK_CHAR TOK_SHORT TOK_INT TOK_LONG TOK_UNSIGNED TOK_SIGNED
+%token<tok> TOK_FLOAT TOK_DOUBLE
+%token<tok> TOK_VOID
+%token<tok> TOK_RETURN TOK_BREAK TOK_CONTINUE
+%token<tok> TOK_CONST TOK_VOLATILE
+%token<tok> TOK_STRUCT TOK_UNION
 
   /*
    * Storage class specifiers: because storage class is optional,
@@ -102,14 +114,21 @@ int yylex(YYSTYPE *, void *);
    * The parse-tree-building parser (parse.y) does not use
    * TOK_UNSPECIFIED_STORAGE, and it will never appear in a parse tree.
    */
-%token<node> TOK_UNSPECIFIED_STORAGE
-%token<node> TOK_STATIC TOK_EXTERN TOK_AUTO
+%token<tok> TOK_UNSPECIFIED_STORAGE
+%token<tok> TOK_STATIC TOK_EXTERN TOK_AUTO
+
+%token<tok> TOK_IDENT
 
-%token<node> TOK_IDENT
+%token<tok> TOK_STR_LIT TOK_CHAR_LIT TOK_INT_LIT TOK_FP_LIT
 
-%token<node> TOK_STR_LIT TOK_CHAR_LIT TOK_INT_LIT TOK_FP_LIT
+  /*
+   * The lexer never produces TOK_FUNCTION_BODY: it is used (see
+   * ParserState::start_token) to parse a function body whose
+   * parsing was deferred, rather than a complete unit.
+   */
+%token<tok> TOK_FUNCTION_BODY
 
-%type<node> unit top_level_declaration function_or_variable_declaration_or_definition
+%type<node> input unit top_level_declaration function_or_variable_declaration_or_definition
 %type<node> simple_variable_declaration
 %type<node> declarator_list declarator non_pointer_declarator
 %type<node> function_definition_or_declaration
@@ -128,101 +147,113 @@ int yylex(YYSTYPE *, void *);
 
 %%
 
+input
+  : unit
+    { $$ = $1; }
+  | TOK_FUNCTION_BODY opt_statement_list
+    { pp->parse_tree = $$ = $2; }
+  ;
+
 unit
   : top_level_declaration
-   { pp->parse_tree = $$ = new Node(NODE_unit, {$1}); }
+   { pp->parse_tree = $$ = new (pp->get_unit_arena()) Node(NODE_unit, {$1}); }
   | top_level_declaration unit
-    { pp->parse_tree = $$ = new Node(NODE_unit, {$1, $2}); }
+    { pp->parse_tree = $$ = new (pp->get_unit_arena()) Node(NODE_unit, {$1, $2}); }
   ;
 
 top_level_declaration
   : function_or_variable_declaration_or_definition
-    { $$ = new Node(NODE_top_level_declaration, {$1}); }
+    { $$ = pp->handle_declaration(new (pp->arena) Node(NODE_top_level_declaration, {$1})); }
   | TOK_STATIC function_or_variable_declaration_or_definition
-    { $$ = new Node(NODE_top_level_declaration, {$1, $2}); }
+    { $$ = pp->handle_declaration(new (pp->arena) Node(NODE_top_level_declaration, {TOKNODE($1), $2})); }
   | TOK_EXTERN function_or_variable_declaration_or_definition
-    { $$ = new Node(NODE_top_level_declaration, {$1, $2}); }
+    { $$ = pp->handle_declaration(new (pp->arena) Node(NODE_top_level_declaration, {TOKNODE($1), $2})); }
   | struct_type_definition
-    { $$ = new Node(NODE_top_level_declaration, {$1}); }
+    { $$ = pp->handle_declaration(new (pp->arena) Node(NODE_top_level_declaration, {$1})); }
   | union_type_definition
-    { $$ = new Node(NODE_top_level_declaration, {$1}); }
+    { $$ = pp->handle_declaration(new (pp->arena) Node(NODE_top_level_declaration, {$1})); }
+    /* error recovery: skip to the end of the declaration */
+  | error TOK_SEMICOLON
+    { $$ = new (pp->get_unit_arena()) Node(NODE_top_level_declaration); }
+  | error TOK_RBRACE
+    { $$ = new (pp->get_unit_arena()) Node(NODE_top_level_declaration); }
   ;
 
 function_or_variable_declaration_or_definition
   : function_definition_or_declaration
-    { $$ = new Node(NODE_function_or_variable_declaration_or_definition, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_function_or_variable_declaration_or_definition, {$1}); }
   | simple_variable_declaration
-    { $$ = new Node(NODE_function_or_variable_declaration_or_definition, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_function_or_variable_declaration_or_definition, {$1}); }
   ;
 
 simple_variable_declaration
   : type declarator_list TOK_SEMICOLON
-    { $$ = new Node(NODE_simple_variable_declaration, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_simple_variable_declaration, {$1, $2}); }
   ;
 
 declarator_list
   : declarator
-    { $$ = new Node(NODE_declarator_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_declarator_list, {$1}); }
   | declarator TOK_COMMA declarator_list
-    { $$ = new Node(NODE_declarator_list, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_declarator_list, {$1, TOKNODE($2), $3}); }
   ;
 
   /* pointers are lower precedence than identifiers/arrays */
 declarator
   : TOK_ASTERISK declarator
-    { $$ = new Node(NODE_declarator, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_declarator, {TOKNODE($1), $2}); }
   | non_pointer_declarator
-    { $$ = new Node(NODE_declarator, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_declarator, {$1}); }
   ;
 
   /* identifiers and arrays are the highest-precedence declarators */
 non_pointer_declarator
   : TOK_IDENT
-    { $$ = new Node(NODE_non_pointer_declarator, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_non_pointer_declarator, {TOKNODE($1)}); }
   | non_pointer_declarator TOK_LBRACKET TOK_INT_LIT TOK_RBRACKET
-    { $$ = new Node(NODE_non_pointer_declarator, {$1, $2, $3, $4}); }
+    { $$ = new (pp->arena) Node(NODE_non_pointer_declarator, {$1, TOKNODE($2), TOKNODE($3), TOKNODE($4)}); }
   ;
 
 function_definition_or_declaration
   : type TOK_IDENT TOK_LPAREN function_parameter_list TOK_RPAREN TOK_LBRACE opt_statement_list TOK_RBRACE
-    { $$ = new Node(NODE_function_definition_or_declaration, {$1, $2, $3, $4, $5, $6, $7, $8}); }
+    { $$ = new (pp->arena) Node(NODE_function_definition_or_declaration, {$1, TOKNODE($2), TOKNODE($3), $4, TOKNODE($5), TOKNODE($6), $7, TOKNODE($8)}); pp->defer_body($$, $7); }
   | type TOK_IDENT TOK_LPAREN function_parameter_list TOK_RPAREN TOK_SEMICOLON
-    { $$ = new Node(NODE_function_definition_or_declaration, {$1, $2, $3, $4, $5, $6}); }
+    { $$ = new (pp->arena) Node(NODE_function_definition_or_declaration, {$1, TOKNODE($2), TOKNODE($3), $4, TOKNODE($5), TOKNODE($6)}); }
   ;
 
 function_parameter_list
   : TOK_VOID
-    { $$ = new Node(NODE_function_parameter_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_function_parameter_list, {TOKNODE($1)}); }
   | opt_parameter_list
-    { $$ = new Node(NODE_function_parameter_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_function_parameter_list, {$1}); }
   ;
 
 opt_parameter_list
   : parameter_list
-    { $$ = new Node(NODE_opt_parameter_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_opt_parameter_list, {$1}); }
   | /* nothing */
-    { $$ = new Node(NODE_opt_parameter_list); }
+    { $$ = new (pp->arena) Node(NODE_opt_parameter_list); }
   ;
 
 parameter_list
   : parameter
-    { $$ = new Node(NODE_parameter_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_parameter_list, {$1}); }
   | parameter TOK_COMMA parameter_list
-    { $$ = new Node(NODE_parameter_list, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_parameter_list, {$1, TOKNODE($2), $3}); }
   ;
 
 parameter
   : type declarator
-    { $$ = new Node(NODE_parameter, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_parameter, {$1, $2}); }
   ;
 
 type
   : basic_type
-    { $$ = new Node(NODE_type, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_type, {$1}); }
   | TOK_STRUCT TOK_IDENT
-    { $$ = new Node(NODE_type, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_type, {TOKNODE($1), TOKNODE($2)}); }
   | TOK_UNION TOK_IDENT
-    { $$ = new Node(NODE_type, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_type, {TOKNODE($1), TOKNODE($2)}); }
   ;
 
   /*
@@ -232,71 +263,71 @@ type
    */
 basic_type
   : basic_type_keyword
-    { $$ = new Node(NODE_basic_type, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type, {$1}); }
   | basic_type_keyword basic_type
-    { $$ = new Node(NODE_basic_type, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type, {$1, $2}); }
   ;
 
 basic_type_keyword
   : TOK_CHAR
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_SHORT
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_INT
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_LONG
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_UNSIGNED
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_SIGNED
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_FLOAT
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_DOUBLE
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_VOID
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_CONST
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   | TOK_VOLATILE
-    { $$ = new Node(NODE_basic_type_keyword, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_basic_type_keyword, {TOKNODE($1)}); }
   ;
 
 opt_statement_list
   : statement_list
-    { $$ = new Node(NODE_opt_statement_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_opt_statement_list, {$1}); }
   | /* nothing */
-    { $$ = new Node(NODE_opt_statement_list); }
+    { $$ = new (pp->arena) Node(NODE_opt_statement_list); }
   ;
 
 statement_list
   : statement
-    { $$ = new Node(NODE_statement_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_statement_list, {$1}); }
   | statement statement_list
-    { $$ = new Node(NODE_statement_list, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_statement_list, {$1, $2}); }
   ;
 
 statement
   : TOK_SEMICOLON
-    { $$ = new Node(NODE_statement, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1)}); }
   | simple_variable_declaration
-    { $$ = new Node(NODE_statement, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {$1}); }
   | TOK_STATIC simple_variable_declaration
-    { $$ = new Node(NODE_statement, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), $2}); }
   | TOK_EXTERN simple_variable_declaration
-    { $$ = new Node(NODE_statement, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), $2}); }
   | assignment_expression TOK_SEMICOLON
-    { $$ = new Node(NODE_statement, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {$1, TOKNODE($2)}); }
   | TOK_RETURN TOK_SEMICOLON
-    { $$ = new Node(NODE_statement, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), TOKNODE($2)}); }
   | TOK_RETURN assignment_expression TOK_SEMICOLON
-    { $$ = new Node(NODE_statement, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), $2, TOKNODE($3)}); }
   | TOK_LBRACE opt_statement_list TOK_RBRACE
-    { $$ = new Node(NODE_statement, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), $2, TOKNODE($3)}); }
   | TOK_WHILE TOK_LPAREN assignment_expression TOK_RPAREN statement
-    { $$ = new Node(NODE_statement, {$1, $2, $3, $4, $5}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), TOKNODE($2), $3, TOKNODE($4), $5}); }
   | TOK_DO statement TOK_WHILE TOK_LPAREN assignment_expression TOK_RPAREN TOK_SEMICOLON
-    { $$ = new Node(NODE_statement, {$1, $2, $3, $4, $5, $6, $7}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), $2, TOKNODE($3), TOKNODE($4), $5, TOKNODE($6), TOKNODE($7)}); }
     /*
      * TODO: allow variable definition in a for loop initializer,
      * and also allow initialization, loop condition, and/or update
@@ -305,35 +336,38 @@ statement
   | TOK_FOR TOK_LPAREN assignment_expression TOK_SEMICOLON
                        assignment_expression TOK_SEMICOLON
                        assignment_expression TOK_RPAREN statement
-    { $$ = new Node(NODE_statement, {$1, $2, $3, $4, $5, $6, $7, $8, $9}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), TOKNODE($2), $3, TOKNODE($4), $5, TOKNODE($6), $7, TOKNODE($8), $9}); }
   | TOK_IF TOK_LPAREN assignment_expression TOK_RPAREN statement
-    { $$ = new Node(NODE_statement, {$1, $2, $3, $4, $5}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), TOKNODE($2), $3, TOKNODE($4), $5}); }
   | TOK_IF TOK_LPAREN assignment_expression TOK_RPAREN statement TOK_ELSE statement
-    { $$ = new Node(NODE_statement, {$1, $2, $3, $4, $5}); }
+    { $$ = new (pp->arena) Node(NODE_statement, {TOKNODE($1), TOKNODE($2), $3, TOKNODE($4), $5}); }
+    /* error recovery: skip to the end of the statement */
+  | error TOK_SEMICOLON
+    { $$ = new (pp->arena) Node(NODE_statement); }
   ;
 
 struct_type_definition
   : TOK_STRUCT TOK_IDENT TOK_LBRACE opt_simple_variable_declaration_list TOK_RBRACE TOK_SEMICOLON
-    { $$ = new Node(NODE_struct_type_definition, {$1, $2, $3, $4, $5}); }
+    { $$ = new (pp->arena) Node(NODE_struct_type_definition, {TOKNODE($1), TOKNODE($2), TOKNODE($3), $4, TOKNODE($5)}); }
   ;
 
 union_type_definition
   : TOK_UNION TOK_IDENT TOK_LBRACE opt_simple_variable_declaration_list TOK_RBRACE TOK_SEMICOLON
-    { $$ = new Node(NODE_union_type_definition, {$1, $2, $3, $4, $5}); }
+    { $$ = new (pp->arena) Node(NODE_union_type_definition, {TOKNODE($1), TOKNODE($2), TOKNODE($3), $4, TOKNODE($5)}); }
   ;
 
 opt_simple_variable_declaration_list
   : simple_variable_declaration_list
-    { $$ = new Node(NODE_opt_simple_variable_declaration_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_opt_simple_variable_declaration_list, {$1}); }
   | /* nothing */
-    { $$ = new Node(NODE_opt_simple_variable_declaration_list); }
+    { $$ = new (pp->arena) Node(NODE_opt_simple_variable_declaration_list); }
   ;
 
 simple_variable_declaration_list
   : simple_variable_declaration
-    { $$ = new Node(NODE_simple_variable_declaration_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_simple_variable_declaration_list, {$1}); }
   | simple_variable_declaration simple_variable_declaration_list
-    { $$ = new Node(NODE_simple_variable_declaration_list, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_simple_variable_declaration_list, {$1, $2}); }
   ;
 
   /*
@@ -343,201 +377,201 @@ simple_variable_declaration_list
 
 assignment_expression
   : unary_expression assignment_op assignment_expression
-    { $$ = new Node(NODE_assignment_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_expression, {$1, $2, $3}); }
   | conditional_expression
-    { $$ = new Node(NODE_assignment_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_expression, {$1}); }
   ;
 
 assignment_op
   : TOK_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_MUL_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_DIV_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_MOD_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_ADD_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_SUB_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_LEFT_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_RIGHT_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_AND_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_XOR_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   | TOK_OR_ASSIGN
-    { $$ = new Node(NODE_assignment_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_assignment_op, {TOKNODE($1)}); }
   ;
 
 conditional_expression
   : logical_or_expression
-    { $$ = new Node(NODE_conditional_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_conditional_expression, {$1}); }
   | logical_or_expression TOK_QUESTION assignment_expression TOK_COLON conditional_expression
-    { $$ = new Node(NODE_conditional_expression, {$1, $2, $3, $4, $5}); }
+    { $$ = new (pp->arena) Node(NODE_conditional_expression, {$1, TOKNODE($2), $3, TOKNODE($4), $5}); }
   ;
 
 logical_or_expression
   : logical_and_expression
-    { $$ = new Node(NODE_logical_or_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_logical_or_expression, {$1}); }
   | logical_or_expression TOK_LOGICAL_OR logical_and_expression
-    { $$ = new Node(NODE_logical_or_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_logical_or_expression, {$1, TOKNODE($2), $3}); }
   ;
 
 logical_and_expression
   : bitwise_or_expression
-    { $$ = new Node(NODE_logical_and_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_logical_and_expression, {$1}); }
   | logical_and_expression TOK_LOGICAL_AND bitwise_or_expression
-    { $$ = new Node(NODE_logical_and_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_logical_and_expression, {$1, TOKNODE($2), $3}); }
   ;
 
 bitwise_or_expression
   : bitwise_xor_expression
-    { $$ = new Node(NODE_bitwise_or_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_bitwise_or_expression, {$1}); }
   | bitwise_or_expression TOK_BITWISE_OR bitwise_xor_expression
-    { $$ = new Node(NODE_bitwise_or_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_bitwise_or_expression, {$1, TOKNODE($2), $3}); }
   ;
 
 bitwise_xor_expression
   : bitwise_and_expression
-   { $$ = new Node(NODE_bitwise_xor_expression, {$1}); }
+   { $$ = new (pp->arena) Node(NODE_bitwise_xor_expression, {$1}); }
   | bitwise_xor_expression TOK_BITWISE_XOR bitwise_and_expression
-   { $$ = new Node(NODE_bitwise_xor_expression, {$1, $2, $3}); }
+   { $$ = new (pp->arena) Node(NODE_bitwise_xor_expression, {$1, TOKNODE($2), $3}); }
   ;
 
 bitwise_and_expression
   : equality_expression
-    { $$ = new Node(NODE_bitwise_and_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_bitwise_and_expression, {$1}); }
   | bitwise_and_expression TOK_AMPERSAND equality_expression
-    { $$ = new Node(NODE_bitwise_and_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_bitwise_and_expression, {$1, TOKNODE($2), $3}); }
   ;
 
 equality_expression
   : relational_expression
-    { $$ = new Node(NODE_equality_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_equality_expression, {$1}); }
   | equality_expression TOK_EQUALITY relational_expression
-    { $$ = new Node(NODE_equality_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_equality_expression, {$1, TOKNODE($2), $3}); }
   | equality_expression TOK_INEQUALITY relational_expression
-    { $$ = new Node(NODE_equality_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_equality_expression, {$1, TOKNODE($2), $3}); }
   ;
 
 relational_expression
   : shift_expression
-    { $$ = new Node(NODE_relational_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_relational_expression, {$1}); }
   | relational_expression relational_op shift_expression
-    { $$ = new Node(NODE_relational_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_relational_expression, {$1, $2, $3}); }
   ;
 
 relational_op
   : TOK_LT
-    { $$ = new Node(NODE_relational_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_relational_op, {TOKNODE($1)}); }
   | TOK_LTE
-    { $$ = new Node(NODE_relational_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_relational_op, {TOKNODE($1)}); }
   | TOK_GT
-    { $$ = new Node(NODE_relational_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_relational_op, {TOKNODE($1)}); }
   | TOK_GTE
-    { $$ = new Node(NODE_relational_op, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_relational_op, {TOKNODE($1)}); }
   ;
 
 shift_expression
   : additive_expression
-    { $$ = new Node(NODE_shift_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_shift_expression, {$1}); }
   | shift_expression TOK_LEFT_SHIFT additive_expression
-    { $$ = new Node(NODE_shift_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_shift_expression, {$1, TOKNODE($2), $3}); }
   | shift_expression TOK_RIGHT_SHIFT additive_expression
-    { $$ = new Node(NODE_shift_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_shift_expression, {$1, TOKNODE($2), $3}); }
   ;
 
 additive_expression
   : multiplicative_expression
-    { $$ = new Node(NODE_additive_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_additive_expression, {$1}); }
   | additive_expression TOK_PLUS multiplicative_expression
-    { $$ = new Node(NODE_additive_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_additive_expression, {$1, TOKNODE($2), $3}); }
   | additive_expression TOK_MINUS multiplicative_expression
-    { $$ = new Node(NODE_additive_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_additive_expression, {$1, TOKNODE($2), $3}); }
   ;
 
 multiplicative_expression
   : cast_expression
-    { $$ = new Node(NODE_multiplicative_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_multiplicative_expression, {$1}); }
   | multiplicative_expression TOK_ASTERISK cast_expression
-    { $$ = new Node(NODE_multiplicative_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_multiplicative_expression, {$1, TOKNODE($2), $3}); }
   | multiplicative_expression TOK_DIVIDE cast_expression
-    { $$ = new Node(NODE_multiplicative_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_multiplicative_expression, {$1, TOKNODE($2), $3}); }
   | multiplicative_expression TOK_MOD cast_expression
-    { $$ = new Node(NODE_multiplicative_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_multiplicative_expression, {$1, TOKNODE($2), $3}); }
   ;
 
 cast_expression
   : unary_expression
-    { $$ = new Node(NODE_cast_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_cast_expression, {$1}); }
   | TOK_LPAREN type TOK_RPAREN cast_expression
-    { $$ = new Node(NODE_cast_expression, {$1, $2, $3, $4}); }
+    { $$ = new (pp->arena) Node(NODE_cast_expression, {TOKNODE($1), $2, TOKNODE($3), $4}); }
   ;
 
 unary_expression
   : postfix_expression
-    { $$ = new Node(NODE_unary_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_unary_expression, {$1}); }
   | TOK_PLUS cast_expression
-    { $$ = new Node(NODE_unary_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_unary_expression, {TOKNODE($1), $2}); }
   | TOK_MINUS cast_expression
-    { $$ = new Node(NODE_unary_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_unary_expression, {TOKNODE($1), $2}); }
   | TOK_NOT cast_expression
-    { $$ = new Node(NODE_unary_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_unary_expression, {TOKNODE($1), $2}); }
   | TOK_BITWISE_COMPL cast_expression
-    { $$ = new Node(NODE_unary_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_unary_expression, {TOKNODE($1), $2}); }
   | TOK_INCREMENT unary_expression
-    { $$ = new Node(NODE_unary_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_unary_expression, {TOKNODE($1), $2}); }
   | TOK_DECREMENT unary_expression
-    { $$ = new Node(NODE_unary_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_unary_expression, {TOKNODE($1), $2}); }
   | TOK_ASTERISK unary_expression
-    { $$ = new Node(NODE_unary_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_unary_expression, {TOKNODE($1), $2}); }
   | TOK_AMPERSAND unary_expression
-    { $$ = new Node(NODE_unary_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_unary_expression, {TOKNODE($1), $2}); }
   ;
 
 postfix_expression
   : primary_expression
-    { $$ = new Node(NODE_postfix_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_postfix_expression, {$1}); }
   | postfix_expression TOK_INCREMENT
-    { $$ = new Node(NODE_postfix_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_postfix_expression, {$1, TOKNODE($2)}); }
   | postfix_expression TOK_DECREMENT
-    { $$ = new Node(NODE_postfix_expression, {$1, $2}); }
+    { $$ = new (pp->arena) Node(NODE_postfix_expression, {$1, TOKNODE($2)}); }
   | postfix_expression TOK_LPAREN TOK_RPAREN
-    { $$ = new Node(NODE_postfix_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_postfix_expression, {$1, TOKNODE($2), TOKNODE($3)}); }
   | postfix_expression TOK_LPAREN argument_expression_list TOK_RPAREN
-    { $$ = new Node(NODE_postfix_expression, {$1, $2, $3, $4}); }
+    { $$ = new (pp->arena) Node(NODE_postfix_expression, {$1, TOKNODE($2), $3, TOKNODE($4)}); }
   | postfix_expression TOK_DOT TOK_IDENT
-    { $$ = new Node(NODE_postfix_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_postfix_expression, {$1, TOKNODE($2), TOKNODE($3)}); }
   | postfix_expression TOK_ARROW TOK_IDENT
-    { $$ = new Node(NODE_postfix_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_postfix_expression, {$1, TOKNODE($2), TOKNODE($3)}); }
   | postfix_expression TOK_LBRACKET assignment_expression TOK_RBRACKET
-    { $$ = new Node(NODE_postfix_expression, {$1, $2, $3, $4}); }
+    { $$ = new (pp->arena) Node(NODE_postfix_expression, {$1, TOKNODE($2), $3, TOKNODE($4)}); }
   ;
 
 argument_expression_list
   : assignment_expression
-    { $$ = new Node(NODE_argument_expression_list, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_argument_expression_list, {$1}); }
   | assignment_expression TOK_COMMA argument_expression_list
-    { $$ = new Node(NODE_argument_expression_list, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_argument_expression_list, {$1, TOKNODE($2), $3}); }
   ;
 
 primary_expression
   : TOK_INT_LIT
-    { $$ = new Node(NODE_primary_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_primary_expression, {TOKNODE($1)}); }
   | TOK_CHAR_LIT
-    { $$ = new Node(NODE_primary_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_primary_expression, {TOKNODE($1)}); }
   | TOK_FP_LIT
-    { $$ = new Node(NODE_primary_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_primary_expression, {TOKNODE($1)}); }
   | TOK_STR_LIT
-    { $$ = new Node(NODE_primary_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_primary_expression, {TOKNODE($1)}); }
   | TOK_IDENT
-    { $$ = new Node(NODE_primary_expression, {$1}); }
+    { $$ = new (pp->arena) Node(NODE_primary_expression, {TOKNODE($1)}); }
   | TOK_LPAREN assignment_expression TOK_RPAREN
-    { $$ = new Node(NODE_primary_expression, {$1, $2, $3}); }
+    { $$ = new (pp->arena) Node(NODE_primary_expression, {TOKNODE($1), $2, TOKNODE($3)}); }
   ;
 
 %%
@@ -0,0 +1,102 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Microbenchmark for parsing many small inputs, where the cost of
+// setting up each parse (rather than the parsing itself) dominates.
+// The same source text is parsed repeatedly, both using a new Context
+// for each parse, and reusing one Context for all of them.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+#include <functional>
+#include "nearly_c.h"
+
+namespace {
+
+const char DEFAULT_SOURCE[] =
+  "int sum(int a, int b) {\n"
+  "  return a + b;\n"
+  "}\n";
+
+// Run a function the given number of times, and return the
+// average time per call in microseconds
+double time_per_call(unsigned count, const std::function<void()> &fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < count; ++i) {
+    fn();
+  }
+  auto end = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::micro> elapsed = end - start;
+  return elapsed.count() / count;
+}
+
+std::string read_source(const char *filename) {
+  FILE *in = fopen(filename, "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "Couldn't open '%s'\n", filename);
+    exit(1);
+  }
+  std::string text;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    text.append(buf, n);
+  }
+  fclose(in);
+  return text;
+}
+
+}
+
+int main(int argc, char **argv) {
+  if (argc > 3) {
+    fprintf(stderr, "Usage: parse_bench [<count> [<filename>]]\n");
+    exit(1);
+  }
+
+  unsigned count = (argc >= 2) ? unsigned(atoi(argv[1])) : 100000;
+  if (count == 0) {
+    count = 1;
+  }
+  std::string text = (argc == 3) ? read_source(argv[2]) : std::string(DEFAULT_SOURCE);
+
+  try {
+    double fresh = time_per_call(count, [&]() {
+      Context ctx;
+      ctx.parse_string(text);
+    });
+
+    Context ctx;
+    double reused = time_per_call(count, [&]() {
+      ctx.parse_string(text);
+    });
+
+    printf("%u parses of %zu bytes\n", count, text.size());
+    printf("  new Context per parse: %8.2f us/parse\n", fresh);
+    printf("  reused Context:        %8.2f us/parse\n", reused);
+  } catch (BaseException &ex) {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    exit(1);
+  }
+
+  return 0;
+}
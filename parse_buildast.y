@@ -28,14 +28,15 @@
 #include "ast.h"
 #include "yyerror.h"
 
-// This is a weird hack required to make bison pass the
-// yyscan_t value representing the scanner state (which is
-// stored in the ParserState object) to yylex()
-#define the_scanner pp->scan_info
+// The parser doesn't call the flex-generated yylex() directly:
+// instead, next_token() (see parser_state.cpp) reads tokens from
+// the ParserState's token table, running the lexer as needed
+#define yylex next_token
 
-// Bison does not actually declare yylex()
-typedef union YYSTYPE YYSTYPE;
-int yylex(YYSTYPE *, void *);
+// The semantic value of a token is its index in the token table,
+// so a Node representing the token must be created when the
+// token is incorporated into the tree
+#define TOKNODE(index) pp->get_token_node(index)
 
 namespace {
   // All variable declarations default to having "unspecified" storage.
@@ -43,10 +44,9 @@ namespace {
   // this will be overridden.
   void handle_unspecified_storage(Node *ast, struct ParserState *pp) {
     Node *first_kid = ast->get_kid(0);
-    Node *unspecified_storage = new Node(NODE_TOK_UNSPECIFIED_STORAGE);
+    Node *unspecified_storage = new (pp->arena) Node(NODE_TOK_UNSPECIFIED_STORAGE);
     unspecified_storage->set_loc(first_kid->get_loc());
     ast->prepend_kid(unspecified_storage);
-    pp->tokens.push_back(unspecified_storage);
   }
 }
 %}
@@ -60,12 +60,10 @@ namespace {
 %parse-param { struct ParserState *pp }
 
   /*
-   * Note that lex-param only controls the actual argument to yylex,
-   * and can only consist of a single token (hence the need to make
-   * it a #define so the lexer state can be accessed within the
-   * ParserState object
+   * The ParserState is also passed to next_token(), since it
+   * has the token table and lexer state
    */
-%lex-param { the_scanner }
+%lex-param { pp }
 
   /*
    * We expect one shift/reduce conflict due to the "dangling else" problem.
@@ -74,36 +72,42 @@ namespace {
    */
 %expect 1
 
+  /*
+   * Make sure the Node type is declared wherever parse.tab.h is included
+   */
+%code requires { class Node; }
+
 %union {
   Node *node;
+  unsigned tok;
 }
 
-%token<node> TOK_LPAREN TOK_RPAREN TOK_LBRACKET TOK_RBRACKET TOK_LBRACE TOK_RBRACE
-%token<node> TOK_SEMICOLON TOK_COLON
-%token<node> TOK_COMMA TOK_DOT TOK_QUESTION TOK_NOT
-%token<node> TOK_ARROW
+%token<tok> TOK_LPAREN TOK_RPAREN TOK_LBRACKET TOK_RBRACKET TOK_LBRACE TOK_RBRACE
+%token<tok> TOK_SEMICOLON TOK_COLON
+%token<tok> TOK_COMMA TOK_DOT TOK_QUESTION TOK_NOT
+%token<tok> TOK_ARROW
 
-%token<node> TOK_PLUS TOK_INCREMENT TOK_MINUS TOK_DECREMENT
-%token<node> TOK_ASTERISK TOK_DIVIDE TOK_MOD
+%token<tok> TOK_PLUS TOK_INCREMENT TOK_MINUS TOK_DECREMENT
+%token<tok> TOK_ASTERISK TOK_DIVIDE TOK_MOD
 
-%token<node> TOK_AMPERSAND TOK_BITWISE_OR TOK_BITWISE_XOR TOK_BITWISE_COMPL
-%token<node> TOK_LEFT_SHIFT TOK_RIGHT_SHIFT
+%token<tok> TOK_AMPERSAND TOK_BITWISE_OR TOK_BITWISE_XOR TOK_BITWISE_COMPL
+%token<tok> TOK_LEFT_SHIFT TOK_RIGHT_SHIFT
 
-%token<node> TOK_LOGICAL_AND TOK_LOGICAL_OR
+%token<tok> TOK_LOGICAL_AND TOK_LOGICAL_OR
 
-%token<node> TOK_EQUALITY TOK_INEQUALITY TOK_LT TOK_LTE TOK_GT TOK_GTE
+%token<tok> TOK_EQUALITY TOK_INEQUALITY TOK_LT TOK_LTE TOK_GT TOK_GTE
 
-%token<node> TOK_ASSIGN TOK_MUL_ASSIGN TOK_DIV_ASSIGN TOK_MOD_ASSIGN TOK_ADD_ASSIGN
-%token<node> TOK_SUB_ASSIGN TOK_LEFT_ASSIGN TOK_RIGHT_ASSIGN TOK_AND_ASSIGN TOK_XOR_ASSIGN
-%token<node> TOK_OR_ASSIGN
+%token<tok> TOK_ASSIGN TOK_MUL_ASSIGN TOK_DIV_ASSIGN TOK_MOD_ASSIGN TOK_ADD_ASSIGN
+%token<tok> TOK_SUB_ASSIGN TOK_LEFT_ASSIGN TOK_RIGHT_ASSIGN TOK_AND_ASSIGN TOK_XOR_ASSIGN
+%token<tok> TOK_OR_ASSIGN
 
-%token<node> TOK_IF TOK_ELSE TOK_WHILE TOK_FOR TOK_DO TOK_SWITCH TOK_CASE
-%token<node> TOK_CHAR TOK_SHORT TOK_INT TOK_LONG TOK_UNSIGNED TOK_SIGNED
-%token<node> TOK_FLOAT TOK_DOUBLE
-%token<node> TOK_VOID
-%token<node> TOK_RETURN TOK_BREAK TOK_CONTINUE
-%token<node> TOK_CONST TOK_VOLATILE
-%token<node> TOK_STRUCT TOK_UNION
+%token<tok> TOK_IF TOK_ELSE TOK_WHILE TOK_FOR TOK_DO TOK_SWITCH TOK_CASE
+%token<tok> TOK_CHAR TOK_SHORT TOK_INT TOK_LONG TOK_UNSIGNED TOK_SIGNED
+%token<tok> TOK_FLOAT TOK_DOUBLE
+%token<tok> TOK_VOID
+%token<tok> TOK_RETURN TOK_BREAK TOK_CONTINUE
+%token<tok> TOK_CONST TOK_VOLATILE
+%token<tok> TOK_STRUCT TOK_UNION
 
   /*
    * Storage class specifiers: because storage class is optional,
@@ -116,14 +120,21 @@ namespace {
    * The parse-tree-building parser (parse.y) does not use
    * TOK_UNSPECIFIED_STORAGE, and it will never appear in a parse tree.
    */
-%token<node> TOK_UNSPECIFIED_STORAGE
-%token<node> TOK_STATIC TOK_EXTERN TOK_AUTO
+%token<tok> TOK_UNSPECIFIED_STORAGE
+%token<tok> TOK_STATIC TOK_EXTERN TOK_AUTO
 
-%token<node> TOK_IDENT
+%token<tok> TOK_IDENT
 
-%token<node> TOK_STR_LIT TOK_CHAR_LIT TOK_INT_LIT TOK_FP_LIT
+%token<tok> TOK_STR_LIT TOK_CHAR_LIT TOK_INT_LIT TOK_FP_LIT
+
+  /*
+   * The lexer never produces TOK_FUNCTION_BODY: it is used (see
+   * ParserState::start_token) to parse a function body whose
+   * parsing was deferred, rather than a complete unit.
+   */
+%token<tok> TOK_FUNCTION_BODY
 
-%type<node> unit top_level_declaration function_or_variable_declaration_or_definition
+%type<node> input unit top_level_declaration function_or_variable_declaration_or_definition
 %type<node> simple_variable_declaration
 %type<node> declarator_list declarator non_pointer_declarator
 %type<node> function_definition_or_declaration
@@ -142,24 +153,36 @@ namespace {
 
 %%
 
+input
+  : unit
+    { $$ = $1; }
+  | TOK_FUNCTION_BODY opt_statement_list
+    { pp->parse_tree = $$ = $2; }
+  ;
+
 unit
   : top_level_declaration
-   { pp->parse_tree = $$ = new Node(AST_UNIT, {$1}); }
-  | top_level_declaration unit
-    { pp->parse_tree = $$ = $2; $$->prepend_kid($1); }
+   { pp->parse_tree = $$ = new (pp->get_unit_arena()) Node(AST_UNIT, {$1}); }
+  | unit top_level_declaration
+    { pp->parse_tree = $$ = $1; $$->append_kid($2); }
   ;
 
 top_level_declaration
   : function_or_variable_declaration_or_definition
-    { $$ = $1; }
+    { $$ = pp->handle_declaration($1); }
   | TOK_STATIC function_or_variable_declaration_or_definition
-    { $$ = $2; $$->shift_kid(); $$->prepend_kid($1); }
+    { $$ = $2; $$->shift_kid(); $$->prepend_kid(TOKNODE($1)); $$ = pp->handle_declaration($$); }
   | TOK_EXTERN function_or_variable_declaration_or_definition
-    { $$ = $2; $$->shift_kid(); $$->prepend_kid($1); }
+    { $$ = $2; $$->shift_kid(); $$->prepend_kid(TOKNODE($1)); $$ = pp->handle_declaration($$); }
   | struct_type_definition
-    { $$ = $1; }
+    { $$ = pp->handle_declaration($1); }
   | union_type_definition
-    { $$ = $1; }
+    { $$ = pp->handle_declaration($1); }
+    /* error recovery: skip to the end of the declaration */
+  | error TOK_SEMICOLON
+    { $$ = new (pp->get_unit_arena()) Node(NODE_top_level_declaration); }
+  | error TOK_RBRACE
+    { $$ = new (pp->get_unit_arena()) Node(NODE_top_level_declaration); }
   ;
 
 function_or_variable_declaration_or_definition
@@ -171,20 +194,20 @@ function_or_variable_declaration_or_definition
 
 simple_variable_declaration
   : type declarator_list TOK_SEMICOLON
-    { $$ = new Node(AST_VARIABLE_DECLARATION, {$1, $2}); handle_unspecified_storage($$, pp);  }
+    { $$ = new (pp->arena) Node(AST_VARIABLE_DECLARATION, {$1, $2}); handle_unspecified_storage($$, pp);  }
   ;
 
 declarator_list
   : declarator
-    { $$ = new Node(AST_DECLARATOR_LIST, {$1}); }
-  | declarator TOK_COMMA declarator_list
-    { $$ = $3; $$->prepend_kid($1); }
+    { $$ = new (pp->arena) Node(AST_DECLARATOR_LIST, {$1}); }
+  | declarator_list TOK_COMMA declarator
+    { $$ = $1; $$->append_kid($3); }
   ;
 
   /* pointers are lower precedence than identifiers/arrays */
 declarator
   : TOK_ASTERISK declarator
-    { $$ = new Node(AST_POINTER_DECLARATOR, {$2}); }
+    { $$ = new (pp->arena) Node(AST_POINTER_DECLARATOR, {$2}); }
   | non_pointer_declarator
     { $$ = $1; }
   ;
@@ -192,21 +215,21 @@ declarator
   /* identifiers and arrays are the highest-precedence declarators */
 non_pointer_declarator
   : TOK_IDENT
-    { $$ = new Node(AST_NAMED_DECLARATOR, {$1}); }
+    { $$ = new (pp->arena) Node(AST_NAMED_DECLARATOR, {TOKNODE($1)}); }
   | non_pointer_declarator TOK_LBRACKET TOK_INT_LIT TOK_RBRACKET
-    { $$ = new Node(AST_ARRAY_DECLARATOR, {$1, $3}); }
+    { $$ = new (pp->arena) Node(AST_ARRAY_DECLARATOR, {$1, TOKNODE($3)}); }
   ;
 
 function_definition_or_declaration
   : type TOK_IDENT TOK_LPAREN function_parameter_list TOK_RPAREN TOK_LBRACE opt_statement_list TOK_RBRACE
-    { $$ = new Node(AST_FUNCTION_DEFINITION, {$1, $2, $4, $7}); }
+    { $$ = new (pp->arena) Node(AST_FUNCTION_DEFINITION, {$1, TOKNODE($2), $4, $7}); pp->defer_body($$, $7); }
   | type TOK_IDENT TOK_LPAREN function_parameter_list TOK_RPAREN TOK_SEMICOLON
-    { $$ = new Node(AST_FUNCTION_DECLARATION, {$1, $2, $4}); }
+    { $$ = new (pp->arena) Node(AST_FUNCTION_DECLARATION, {$1, TOKNODE($2), $4}); }
   ;
 
 function_parameter_list
   : TOK_VOID
-    { $$ = new Node(AST_FUNCTION_PARAMETER_LIST); }
+    { $$ = new (pp->arena) Node(AST_FUNCTION_PARAMETER_LIST); }
   | opt_parameter_list
     { $$ = $1; }
   ;
@@ -215,28 +238,28 @@ opt_parameter_list
   : parameter_list
     { $$ = $1; }
   | /* nothing */
-    { $$ = new Node(AST_FUNCTION_PARAMETER_LIST); }
+    { $$ = new (pp->arena) Node(AST_FUNCTION_PARAMETER_LIST); }
   ;
 
 parameter_list
   : parameter
-    { $$ = new Node(AST_FUNCTION_PARAMETER_LIST, {$1}); }
-  | parameter TOK_COMMA parameter_list
-    { $$ = $3; $$->prepend_kid($1); }
+    { $$ = new (pp->arena) Node(AST_FUNCTION_PARAMETER_LIST, {$1}); }
+  | parameter_list TOK_COMMA parameter
+    { $$ = $1; $$->append_kid($3); }
   ;
 
 parameter
   : type declarator
-    { $$ = new Node(AST_FUNCTION_PARAMETER, {$1, $2}); }
+    { $$ = new (pp->arena) Node(AST_FUNCTION_PARAMETER, {$1, $2}); }
   ;
 
 type
   : basic_type
     { $$ = $1; }
   | TOK_STRUCT TOK_IDENT
-    { $$ = new Node(AST_STRUCT_TYPE, {$2}); }
+    { $$ = new (pp->arena) Node(AST_STRUCT_TYPE, {TOKNODE($2)}); }
   | TOK_UNION TOK_IDENT
-    { $$ = new Node(AST_UNION_TYPE, {$2}); }
+    { $$ = new (pp->arena) Node(AST_UNION_TYPE, {TOKNODE($2)}); }
   ;
 
   /*
@@ -246,71 +269,71 @@ type
    */
 basic_type
   : basic_type_keyword
-    { $$ = new Node(AST_BASIC_TYPE, {$1}); }
-  | basic_type_keyword basic_type
-    { $$ = $2; $$->prepend_kid($1); }
+    { $$ = new (pp->arena) Node(AST_BASIC_TYPE, {$1}); }
+  | basic_type basic_type_keyword
+    { $$ = $1; $$->append_kid($2); }
   ;
 
 basic_type_keyword
   : TOK_CHAR
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_SHORT
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_INT
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_LONG
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_UNSIGNED
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_SIGNED
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_FLOAT
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_DOUBLE
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_VOID
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_CONST
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_VOLATILE
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   ;
 
 opt_statement_list
   : statement_list
     { $$ = $1; }
   | /* nothing */
-    { $$ = new Node(AST_STATEMENT_LIST); }
+    { $$ = new (pp->arena) Node(AST_STATEMENT_LIST); }
   ;
 
 statement_list
   : statement
-    { $$ = new Node(AST_STATEMENT_LIST, {$1}); }
-  | statement statement_list
-    { $$ = $2; $$->prepend_kid($1); }
+    { $$ = new (pp->arena) Node(AST_STATEMENT_LIST, {$1}); }
+  | statement_list statement
+    { $$ = $1; $$->append_kid($2); }
   ;
 
 statement
   : TOK_SEMICOLON
-    { $$ = new Node(AST_EMPTY_STATEMENT); }
+    { $$ = new (pp->arena) Node(AST_EMPTY_STATEMENT); }
   | simple_variable_declaration
     { $$ = $1; }
   | TOK_STATIC simple_variable_declaration
-    { $$ = $2; $$->shift_kid(); $$->prepend_kid($1); }
+    { $$ = $2; $$->shift_kid(); $$->prepend_kid(TOKNODE($1)); }
   | TOK_EXTERN simple_variable_declaration
-    { $$ = $2; $$->shift_kid(); $$->prepend_kid($1); }
+    { $$ = $2; $$->shift_kid(); $$->prepend_kid(TOKNODE($1)); }
   | assignment_expression TOK_SEMICOLON
-    { $$ = new Node(AST_EXPRESSION_STATEMENT, {$1}); }
+    { $$ = new (pp->arena) Node(AST_EXPRESSION_STATEMENT, {$1}); }
   | TOK_RETURN TOK_SEMICOLON
-    { $$ = new Node(AST_RETURN_STATEMENT); }
+    { $$ = new (pp->arena) Node(AST_RETURN_STATEMENT); }
   | TOK_RETURN assignment_expression TOK_SEMICOLON
-    { $$ = new Node(AST_RETURN_EXPRESSION_STATEMENT, {$2}); }
+    { $$ = new (pp->arena) Node(AST_RETURN_EXPRESSION_STATEMENT, {$2}); }
   | TOK_LBRACE opt_statement_list TOK_RBRACE
     { $$ = $2;  }
   | TOK_WHILE TOK_LPAREN assignment_expression TOK_RPAREN statement
-    { $$ = new Node(AST_WHILE_STATEMENT, {$3, $5}); }
+    { $$ = new (pp->arena) Node(AST_WHILE_STATEMENT, {$3, $5}); }
   | TOK_DO statement TOK_WHILE TOK_LPAREN assignment_expression TOK_RPAREN TOK_SEMICOLON
-    { $$ = new Node(AST_DO_WHILE_STATEMENT, {$2, $5}); }
+    { $$ = new (pp->arena) Node(AST_DO_WHILE_STATEMENT, {$2, $5}); }
     /*
      * TODO: allow variable definition in a for loop initializer,
      * and also allow initialization, loop condition, and/or update
@@ -319,35 +342,38 @@ statement
   | TOK_FOR TOK_LPAREN assignment_expression TOK_SEMICOLON
                        assignment_expression TOK_SEMICOLON
                        assignment_expression TOK_RPAREN statement
-    { $$ = new Node(AST_FOR_STATEMENT, {$3, $5, $7, $9}); }
+    { $$ = new (pp->arena) Node(AST_FOR_STATEMENT, {$3, $5, $7, $9}); }
   | TOK_IF TOK_LPAREN assignment_expression TOK_RPAREN statement
-    { $$ = new Node(AST_IF_STATEMENT, {$3, $5}); }
+    { $$ = new (pp->arena) Node(AST_IF_STATEMENT, {$3, $5}); }
   | TOK_IF TOK_LPAREN assignment_expression TOK_RPAREN statement TOK_ELSE statement
-    { $$ = new Node(AST_IF_ELSE_STATEMENT, {$3, $5, $7}); }
+    { $$ = new (pp->arena) Node(AST_IF_ELSE_STATEMENT, {$3, $5, $7}); }
+    /* error recovery: skip to the end of the statement */
+  | error TOK_SEMICOLON
+    { $$ = new (pp->arena) Node(NODE_statement); }
   ;
 
 struct_type_definition
   : TOK_STRUCT TOK_IDENT TOK_LBRACE opt_simple_variable_declaration_list TOK_RBRACE TOK_SEMICOLON
-    { $$ = new Node(AST_STRUCT_TYPE_DEFINITION, {$2, $4}); }
+    { $$ = new (pp->arena) Node(AST_STRUCT_TYPE_DEFINITION, {TOKNODE($2), $4}); }
   ;
 
 union_type_definition
   : TOK_UNION TOK_IDENT TOK_LBRACE opt_simple_variable_declaration_list TOK_RBRACE TOK_SEMICOLON
-    { $$ = new Node(AST_UNION_TYPE_DEFINITION, {$2, $4}); }
+    { $$ = new (pp->arena) Node(AST_UNION_TYPE_DEFINITION, {TOKNODE($2), $4}); }
   ;
 
 opt_simple_variable_declaration_list
   : simple_variable_declaration_list
     { $$ = $1; }
   | /* nothing */
-    { $$ = new Node(AST_FIELD_DEFINITION_LIST); }
+    { $$ = new (pp->arena) Node(AST_FIELD_DEFINITION_LIST); }
   ;
 
 simple_variable_declaration_list
   : simple_variable_declaration
-    { $$ = new Node(AST_FIELD_DEFINITION_LIST, {$1}); }
-  | simple_variable_declaration simple_variable_declaration_list
-    { $$ = $2; $$->prepend_kid($1); }
+    { $$ = new (pp->arena) Node(AST_FIELD_DEFINITION_LIST, {$1}); }
+  | simple_variable_declaration_list simple_variable_declaration
+    { $$ = $1; $$->append_kid($2); }
   ;
 
   /*
@@ -366,160 +392,160 @@ simple_variable_declaration_list
 
 assignment_expression
   : unary_expression assignment_op assignment_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
   | conditional_expression
     { $$ = $1; }
   ;
 
 assignment_op
   : TOK_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_MUL_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_DIV_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_MOD_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_ADD_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_SUB_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_LEFT_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_RIGHT_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_AND_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_XOR_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_OR_ASSIGN
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   ;
 
 conditional_expression
   : logical_or_expression
     { $$ = $1; }
   | logical_or_expression TOK_QUESTION assignment_expression TOK_COLON conditional_expression
-    { $$ = new Node(AST_CONDITIONAL_EXPRESSION, {$1, $3, $5}); }
+    { $$ = new (pp->arena) Node(AST_CONDITIONAL_EXPRESSION, {$1, $3, $5}); }
   ;
 
 logical_or_expression
   : logical_and_expression
     { $$ = $1; }
   | logical_or_expression TOK_LOGICAL_OR logical_and_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   ;
 
 logical_and_expression
   : bitwise_or_expression
     { $$ = $1; }
   | logical_and_expression TOK_LOGICAL_AND bitwise_or_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   ;
 
 bitwise_or_expression
   : bitwise_xor_expression
     { $$ = $1; }
   | bitwise_or_expression TOK_BITWISE_OR bitwise_xor_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   ;
 
 bitwise_xor_expression
   : bitwise_and_expression
     { $$ = $1; }
   | bitwise_xor_expression TOK_BITWISE_XOR bitwise_and_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   ;
 
 bitwise_and_expression
   : equality_expression
     { $$ = $1; }
   | bitwise_and_expression TOK_AMPERSAND equality_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   ;
 
 equality_expression
   : relational_expression
     { $$ = $1; }
   | equality_expression TOK_EQUALITY relational_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   | equality_expression TOK_INEQUALITY relational_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   ;
 
 relational_expression
   : shift_expression
     { $$ = $1; }
   | relational_expression relational_op shift_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
   ;
 
 relational_op
   : TOK_LT
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_LTE
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_GT
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   | TOK_GTE
-    { $$ = $1; }
+    { $$ = TOKNODE($1); }
   ;
 
 shift_expression
   : additive_expression
     { $$ = $1; }
   | shift_expression TOK_LEFT_SHIFT additive_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   | shift_expression TOK_RIGHT_SHIFT additive_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   ;
 
 additive_expression
   : multiplicative_expression
     { $$ = $1; }
   | additive_expression TOK_PLUS multiplicative_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   | additive_expression TOK_MINUS multiplicative_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   ;
 
 multiplicative_expression
   : cast_expression
     { $$ = $1; }
   | multiplicative_expression TOK_ASTERISK cast_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   | multiplicative_expression TOK_DIVIDE cast_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   | multiplicative_expression TOK_MOD cast_expression
-    { $$ = new Node(AST_BINARY_EXPRESSION, {$2, $1, $3}); }
+    { $$ = new (pp->arena) Node(AST_BINARY_EXPRESSION, {TOKNODE($2), $1, $3}); }
   ;
 
 cast_expression
   : unary_expression
     { $$ = $1; }
   | TOK_LPAREN type TOK_RPAREN cast_expression
-    { $$ = new Node(AST_CAST_EXPRESSION, {$2, $4}); }
+    { $$ = new (pp->arena) Node(AST_CAST_EXPRESSION, {$2, $4}); }
   ;
 
 unary_expression
   : postfix_expression
     { $$ = $1; }
   | TOK_PLUS cast_expression
-    { $$ = new Node(AST_UNARY_EXPRESSION, {$1, $2}); }
+    { $$ = new (pp->arena) Node(AST_UNARY_EXPRESSION, {TOKNODE($1), $2}); }
   | TOK_MINUS cast_expression
-    { $$ = new Node(AST_UNARY_EXPRESSION, {$1, $2}); }
+    { $$ = new (pp->arena) Node(AST_UNARY_EXPRESSION, {TOKNODE($1), $2}); }
   | TOK_NOT cast_expression
-    { $$ = new Node(AST_UNARY_EXPRESSION, {$1, $2}); }
+    { $$ = new (pp->arena) Node(AST_UNARY_EXPRESSION, {TOKNODE($1), $2}); }
   | TOK_BITWISE_COMPL cast_expression
-    { $$ = new Node(AST_UNARY_EXPRESSION, {$1, $2}); }
+    { $$ = new (pp->arena) Node(AST_UNARY_EXPRESSION, {TOKNODE($1), $2}); }
   | TOK_INCREMENT unary_expression
-    { $$ = new Node(AST_UNARY_EXPRESSION, {$1, $2}); }
+    { $$ = new (pp->arena) Node(AST_UNARY_EXPRESSION, {TOKNODE($1), $2}); }
   | TOK_DECREMENT unary_expression
-    { $$ = new Node(AST_UNARY_EXPRESSION, {$1, $2}); }
+    { $$ = new (pp->arena) Node(AST_UNARY_EXPRESSION, {TOKNODE($1), $2}); }
   | TOK_ASTERISK unary_expression
-    { $$ = new Node(AST_UNARY_EXPRESSION, {$1, $2}); }
+    { $$ = new (pp->arena) Node(AST_UNARY_EXPRESSION, {TOKNODE($1), $2}); }
   | TOK_AMPERSAND unary_expression
-    { $$ = new Node(AST_UNARY_EXPRESSION, {$1, $2}); }
+    { $$ = new (pp->arena) Node(AST_UNARY_EXPRESSION, {TOKNODE($1), $2}); }
   ;
 
   /*
@@ -534,39 +560,39 @@ postfix_expression
   : primary_expression
     { $$ = $1; }
   | postfix_expression TOK_INCREMENT
-    { $$ = new Node(AST_POSTFIX_EXPRESSION, {$2, $1}); }
+    { $$ = new (pp->arena) Node(AST_POSTFIX_EXPRESSION, {TOKNODE($2), $1}); }
   | postfix_expression TOK_DECREMENT
-    { $$ = new Node(AST_POSTFIX_EXPRESSION, {$2, $1}); }
+    { $$ = new (pp->arena) Node(AST_POSTFIX_EXPRESSION, {TOKNODE($2), $1}); }
   | postfix_expression TOK_LPAREN TOK_RPAREN
-    { $$ = new Node(AST_FUNCTION_CALL_EXPRESSION, {$1, new Node(AST_ARGUMENT_EXPRESSION_LIST)}); }
+    { $$ = new (pp->arena) Node(AST_FUNCTION_CALL_EXPRESSION, {$1, new (pp->arena) Node(AST_ARGUMENT_EXPRESSION_LIST)}); }
   | postfix_expression TOK_LPAREN argument_expression_list TOK_RPAREN
-    { $$ = new Node(AST_FUNCTION_CALL_EXPRESSION, {$1, $3}); }
+    { $$ = new (pp->arena) Node(AST_FUNCTION_CALL_EXPRESSION, {$1, $3}); }
   | postfix_expression TOK_DOT TOK_IDENT
-    { $$ = new Node(AST_FIELD_REF_EXPRESSION, {$1, $3}); }
+    { $$ = new (pp->arena) Node(AST_FIELD_REF_EXPRESSION, {$1, TOKNODE($3)}); }
   | postfix_expression TOK_ARROW TOK_IDENT
-    { $$ = new Node(AST_INDIRECT_FIELD_REF_EXPRESSION, {$1, $3}); }
+    { $$ = new (pp->arena) Node(AST_INDIRECT_FIELD_REF_EXPRESSION, {$1, TOKNODE($3)}); }
   | postfix_expression TOK_LBRACKET assignment_expression TOK_RBRACKET
-    { $$ = new Node(AST_ARRAY_ELEMENT_REF_EXPRESSION, {$1, $3}); }
+    { $$ = new (pp->arena) Node(AST_ARRAY_ELEMENT_REF_EXPRESSION, {$1, $3}); }
   ;
 
 argument_expression_list
   : assignment_expression
-    { $$ = new Node(AST_ARGUMENT_EXPRESSION_LIST, {$1}); }
-  | assignment_expression TOK_COMMA argument_expression_list
-    { $$ = $3; $$->prepend_kid($1); }
+    { $$ = new (pp->arena) Node(AST_ARGUMENT_EXPRESSION_LIST, {$1}); }
+  | argument_expression_list TOK_COMMA assignment_expression
+    { $$ = $1; $$->append_kid($3); }
   ;
 
 primary_expression
   : TOK_INT_LIT
-    { $$ = new Node(AST_LITERAL_VALUE, {$1}); }
+    { $$ = new (pp->arena) Node(AST_LITERAL_VALUE, {TOKNODE($1)}); }
   | TOK_CHAR_LIT
-    { $$ = new Node(AST_LITERAL_VALUE, {$1}); }
+    { $$ = new (pp->arena) Node(AST_LITERAL_VALUE, {TOKNODE($1)}); }
   | TOK_FP_LIT
-    { $$ = new Node(AST_LITERAL_VALUE, {$1}); }
+    { $$ = new (pp->arena) Node(AST_LITERAL_VALUE, {TOKNODE($1)}); }
   | TOK_STR_LIT
-    { $$ = new Node(AST_LITERAL_VALUE, {$1}); }
+    { $$ = new (pp->arena) Node(AST_LITERAL_VALUE, {TOKNODE($1)}); }
   | TOK_IDENT
-    { $$ = new Node(AST_VARIABLE_REF, {$1}); }
+    { $$ = new (pp->arena) Node(AST_VARIABLE_REF, {TOKNODE($1)}); }
   | TOK_LPAREN assignment_expression TOK_RPAREN
     { $$ = $2; }
   ;
@@ -0,0 +1,235 @@
+// Copyright (c) 2021-2022, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "node.h"
+#include "ast.h"
+#include "cpputil.h"
+#include "parse_stats.h"
+
+namespace {
+
+const char *const PHASE_NAMES[ParseStats::NUM_PHASES] = {
+  "setup", "lex", "parse", "cleanup", "print", "teardown",
+};
+
+unsigned long get_time_ns(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (unsigned long)ts.tv_sec * 1000000000UL + (unsigned long)ts.tv_nsec;
+}
+
+// Get the tag counts sorted by decreasing count
+// (and by increasing tag if the counts are equal)
+std::vector<std::pair<int, unsigned long>> sort_tag_counts(const std::map<int, unsigned long> &tag_counts) {
+  std::vector<std::pair<int, unsigned long>> result(tag_counts.begin(), tag_counts.end());
+  std::stable_sort(result.begin(), result.end(),
+                   [](const std::pair<int, unsigned long> &a, const std::pair<int, unsigned long> &b) {
+                     return a.second > b.second;
+                   });
+  return result;
+}
+
+}
+
+void ParseStats::PhaseTimer::start(Phase phase) {
+  m_phase = phase;
+  m_outer = m_stats->m_active;
+  m_stats->m_active = this;
+  m_inner_wall_ns = 0;
+  m_inner_cpu_ns = 0;
+  m_start_wall_ns = get_time_ns(CLOCK_MONOTONIC);
+  m_start_cpu_ns = get_time_ns(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+void ParseStats::PhaseTimer::stop() {
+  unsigned long wall_ns = get_time_ns(CLOCK_MONOTONIC) - m_start_wall_ns;
+  unsigned long cpu_ns = get_time_ns(CLOCK_PROCESS_CPUTIME_ID) - m_start_cpu_ns;
+
+  // the time spent in inner timers was added to their phases
+  m_stats->m_wall_ns[m_phase] += wall_ns - std::min(wall_ns, m_inner_wall_ns);
+  m_stats->m_cpu_ns[m_phase] += cpu_ns - std::min(cpu_ns, m_inner_cpu_ns);
+
+  m_stats->m_active = m_outer;
+  if (m_outer != nullptr) {
+    m_outer->m_inner_wall_ns += wall_ns;
+    m_outer->m_inner_cpu_ns += cpu_ns;
+  }
+}
+
+ParseStats::ParseStats() : m_active(nullptr) {
+  clear();
+}
+
+ParseStats::~ParseStats() {
+}
+
+void ParseStats::clear() {
+  for (unsigned i = 0; i < NUM_PHASES; ++i) {
+    m_wall_ns[i] = 0;
+    m_cpu_ns[i] = 0;
+  }
+  m_num_inputs = 0;
+  m_num_tokens = 0;
+  m_num_nodes_allocated = 0;
+  m_bytes_allocated = 0;
+  m_num_tree_nodes = 0;
+  m_peak_token_bytes = 0;
+  m_peak_string_bytes = 0;
+  m_max_depth = 0;
+  m_tag_counts.clear();
+}
+
+void ParseStats::add(const ParseStats &other) {
+  for (unsigned i = 0; i < NUM_PHASES; ++i) {
+    m_wall_ns[i] += other.m_wall_ns[i];
+    m_cpu_ns[i] += other.m_cpu_ns[i];
+  }
+  m_num_inputs += other.m_num_inputs;
+  m_num_tokens += other.m_num_tokens;
+  m_num_nodes_allocated += other.m_num_nodes_allocated;
+  m_bytes_allocated += other.m_bytes_allocated;
+  m_num_tree_nodes += other.m_num_tree_nodes;
+  m_peak_token_bytes = std::max(m_peak_token_bytes, other.m_peak_token_bytes);
+  m_peak_string_bytes = std::max(m_peak_string_bytes, other.m_peak_string_bytes);
+  m_max_depth = std::max(m_max_depth, other.m_max_depth);
+  for (auto i = other.m_tag_counts.begin(); i != other.m_tag_counts.end(); ++i) {
+    m_tag_counts[i->first] += i->second;
+  }
+}
+
+void ParseStats::record_input(unsigned long num_tokens) {
+  ++m_num_inputs;
+  m_num_tokens += num_tokens;
+}
+
+void ParseStats::record_allocation(unsigned long num_nodes, unsigned long bytes) {
+  m_num_nodes_allocated += num_nodes;
+  m_bytes_allocated += bytes;
+}
+
+void ParseStats::record_memory(unsigned long token_bytes, unsigned long string_bytes) {
+  m_peak_token_bytes = std::max(m_peak_token_bytes, token_bytes);
+  m_peak_string_bytes = std::max(m_peak_string_bytes, string_bytes);
+}
+
+void ParseStats::record_tree(Node *root, unsigned depth) {
+  if (root == nullptr) {
+    return;
+  }
+
+  root->traverse(
+    [this, depth](Node *n, unsigned d) {
+      ++m_num_tree_nodes;
+      ++m_tag_counts[n->get_tag()];
+      m_max_depth = std::max(m_max_depth, depth + d + 1);
+      return TRAVERSE_CONTINUE;
+    },
+    [](Node *, unsigned) { return TRAVERSE_CONTINUE; });
+}
+
+const char *ParseStats::get_phase_name(Phase phase) {
+  return PHASE_NAMES[phase];
+}
+
+unsigned long ParseStats::get_peak_rss() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  // ru_maxrss is in kilobytes
+  return (unsigned long)usage.ru_maxrss * 1024UL;
+}
+
+unsigned long ParseStats::get_current_rss() {
+  // the second field of /proc/self/statm is the RSS in pages
+  // (this is Linux-specific)
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f == nullptr) {
+    return 0;
+  }
+  unsigned long size, resident;
+  bool ok = (fscanf(f, "%lu %lu", &size, &resident) == 2);
+  fclose(f);
+  return ok ? resident * (unsigned long)sysconf(_SC_PAGESIZE) : 0;
+}
+
+std::string ParseStats::format() const {
+  std::string result;
+  unsigned long total_wall_ns = 0, total_cpu_ns = 0;
+  result += cpputil::format("%-10s %12s %12s\n", "phase", "wall ms", "cpu ms");
+  for (unsigned i = 0; i < NUM_PHASES; ++i) {
+    result += cpputil::format("%-10s %12.3f %12.3f\n", PHASE_NAMES[i], m_wall_ns[i] / 1e6, m_cpu_ns[i] / 1e6);
+    total_wall_ns += m_wall_ns[i];
+    total_cpu_ns += m_cpu_ns[i];
+  }
+  result += cpputil::format("%-10s %12.3f %12.3f\n", "total", total_wall_ns / 1e6, total_cpu_ns / 1e6);
+
+  result += cpputil::format("inputs: %lu\n", m_num_inputs);
+  result += cpputil::format("tokens: %lu\n", m_num_tokens);
+  result += cpputil::format("nodes allocated: %lu (%lu bytes, %.1f MiB)\n", m_num_nodes_allocated,
+                            m_bytes_allocated, m_bytes_allocated / (1024.0 * 1024.0));
+  result += cpputil::format("nodes in trees: %lu\n", m_num_tree_nodes);
+  result += cpputil::format("max tree depth: %u\n", m_max_depth);
+  result += cpputil::format("peak token memory: %lu bytes\n", m_peak_token_bytes);
+  result += cpputil::format("peak string memory: %lu bytes\n", m_peak_string_bytes);
+  unsigned long peak_rss = get_peak_rss();
+  result += cpputil::format("peak RSS: %lu bytes (%.1f MiB)\n", peak_rss, peak_rss / (1024.0 * 1024.0));
+
+  if (!m_tag_counts.empty()) {
+    result += "nodes by tag:\n";
+    ASTTreePrint tag_print;
+    std::vector<std::pair<int, unsigned long>> counts = sort_tag_counts(m_tag_counts);
+    for (auto i = counts.begin(); i != counts.end(); ++i) {
+      result += cpputil::format("  %10lu %s\n", i->second, tag_print.node_tag_to_string(i->first).c_str());
+    }
+  }
+
+  return result;
+}
+
+std::string ParseStats::format_json() const {
+  // the phase and tag names don't need to be escaped
+  std::string result = "{\"phases\":{";
+  for (unsigned i = 0; i < NUM_PHASES; ++i) {
+    result += cpputil::format("%s\"%s\":{\"wall_us\":%lu,\"cpu_us\":%lu}", i > 0 ? "," : "",
+                              PHASE_NAMES[i], m_wall_ns[i] / 1000, m_cpu_ns[i] / 1000);
+  }
+  result += cpputil::format("},\"inputs\":%lu,\"tokens\":%lu,\"nodes_allocated\":%lu,\"bytes_allocated\":%lu"
+                            ",\"tree_nodes\":%lu,\"max_depth\":%u,\"peak_token_bytes\":%lu"
+                            ",\"peak_string_bytes\":%lu,\"peak_rss\":%lu,\"tags\":[",
+                            m_num_inputs, m_num_tokens, m_num_nodes_allocated, m_bytes_allocated,
+                            m_num_tree_nodes, m_max_depth, m_peak_token_bytes, m_peak_string_bytes,
+                            get_peak_rss());
+
+  ASTTreePrint tag_print;
+  std::vector<std::pair<int, unsigned long>> counts = sort_tag_counts(m_tag_counts);
+  for (auto i = counts.begin(); i != counts.end(); ++i) {
+    result += cpputil::format("%s{\"tag\":%d,\"name\":\"%s\",\"count\":%lu}", i != counts.begin() ? "," : "",
+                              i->first, tag_print.node_tag_to_string(i->first).c_str(), i->second);
+  }
+  result += "]}\n";
+  return result;
+}
@@ -0,0 +1,193 @@
+// Copyright (c) 2021-2022, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef PARSE_STATS_H
+#define PARSE_STATS_H
+
+#include <map>
+#include <string>
+#include <cstddef>
+class Node;
+
+//! A ParseStats object accumulates statistics about the inputs
+//! processed by a Context (see Context::set_stats()): the wall clock
+//! and CPU time spent in each phase, the numbers of tokens and Nodes,
+//! the number of Nodes with each tag, the bytes allocated for Nodes,
+//! the peak memory used for tokens and strings, and the depth of the
+//! deepest tree. If a Context has no ParseStats
+//! (the default), the only cost is a null pointer check in each phase.
+//!
+//! The CPU time is that of the whole process, so it includes the
+//! time used by helper threads (e.g., the lexer thread when pipelining,
+//! and the worker threads when scanning or parsing in parallel), but
+//! also that of any other threads running at the same time.
+//!
+//! A ParseStats may only be used from one thread at a time.
+class ParseStats {
+public:
+  //! The phases which are timed.
+  enum Phase {
+    PHASE_SETUP,    //!< loading the input and setting up the scanner
+    PHASE_LEX,      //!< scanning the entire input before parsing
+    PHASE_PARSE,    //!< parsing (including on-demand scanning)
+    PHASE_CLEANUP,  //!< deleting Nodes not incorporated into the tree
+    PHASE_PRINT,    //!< printing the output
+    PHASE_TEARDOWN, //!< destroying trees
+    NUM_PHASES,
+  };
+
+  //! A PhaseTimer adds the time from its construction to its
+  //! destruction to a phase. Timers can be nested: the time spent
+  //! in an inner timer's phase is excluded from the outer timer's
+  //! phase, so each phase's time is exclusive. If the ParseStats is
+  //! null, the timer does nothing.
+  class PhaseTimer {
+  private:
+    ParseStats *m_stats;
+    Phase m_phase;
+    PhaseTimer *m_outer;
+    unsigned long m_start_wall_ns, m_start_cpu_ns;
+    unsigned long m_inner_wall_ns, m_inner_cpu_ns;
+
+    // copy ctor and assignment operator not allowed
+    PhaseTimer(const PhaseTimer &);
+    PhaseTimer &operator=(const PhaseTimer &);
+
+  public:
+    PhaseTimer(ParseStats *stats, Phase phase) : m_stats(stats) {
+      if (m_stats != nullptr) {
+        start(phase);
+      }
+    }
+
+    ~PhaseTimer() {
+      if (m_stats != nullptr) {
+        stop();
+      }
+    }
+
+  private:
+    void start(Phase phase);
+    void stop();
+  };
+
+private:
+  unsigned long m_wall_ns[NUM_PHASES];
+  unsigned long m_cpu_ns[NUM_PHASES];
+  unsigned long m_num_inputs;
+  unsigned long m_num_tokens;
+  unsigned long m_num_nodes_allocated;
+  unsigned long m_bytes_allocated;
+  unsigned long m_num_tree_nodes;
+  unsigned long m_peak_token_bytes;
+  unsigned long m_peak_string_bytes;
+  unsigned m_max_depth;
+  std::map<int, unsigned long> m_tag_counts;
+  PhaseTimer *m_active;
+
+  // copy ctor and assignment operator not allowed
+  ParseStats(const ParseStats &);
+  ParseStats &operator=(const ParseStats &);
+
+public:
+  ParseStats();
+  ~ParseStats();
+
+  //! Reset all of the statistics to zero.
+  void clear();
+
+  //! Add the statistics accumulated by another ParseStats object
+  //! (e.g., one used by another thread.)
+  //! @param other the other ParseStats object
+  void add(const ParseStats &other);
+
+  //! Record an input.
+  //! @param num_tokens the number of tokens scanned from the input
+  void record_input(unsigned long num_tokens);
+
+  //! Record memory allocated in an arena.
+  //! @param num_nodes the number of Nodes allocated
+  //! @param bytes the number of bytes allocated
+  void record_allocation(unsigned long num_nodes, unsigned long bytes);
+
+  //! Record the memory used for tokens (see TokenTable) and strings
+  //! (see Interner); the peak amounts are kept.
+  //! @param token_bytes the number of bytes used for tokens
+  //! @param string_bytes the number of bytes used for strings
+  void record_memory(unsigned long token_bytes, unsigned long string_bytes);
+
+  //! Record the Nodes of a tree (or subtree): the number of Nodes
+  //! with each tag, and the depth of the tree (a single Node has
+  //! depth 1.)
+  //! @param root the root of the tree (may be null)
+  //! @param depth the depth of the root in the enclosing tree
+  //!              (0 if it is the root of the entire tree)
+  void record_tree(Node *root, unsigned depth = 0);
+
+  //! Get the wall clock time spent in a phase.
+  //! @param phase the phase
+  //! @return the time in nanoseconds
+  unsigned long get_wall_ns(Phase phase) const { return m_wall_ns[phase]; }
+
+  //! Get the CPU time spent in a phase.
+  //! @param phase the phase
+  //! @return the time in nanoseconds
+  unsigned long get_cpu_ns(Phase phase) const { return m_cpu_ns[phase]; }
+
+  unsigned long get_num_inputs() const { return m_num_inputs; }
+  unsigned long get_num_tokens() const { return m_num_tokens; }
+  unsigned long get_num_nodes_allocated() const { return m_num_nodes_allocated; }
+  unsigned long get_bytes_allocated() const { return m_bytes_allocated; }
+  unsigned long get_num_tree_nodes() const { return m_num_tree_nodes; }
+  unsigned long get_peak_token_bytes() const { return m_peak_token_bytes; }
+  unsigned long get_peak_string_bytes() const { return m_peak_string_bytes; }
+  unsigned get_max_depth() const { return m_max_depth; }
+  const std::map<int, unsigned long> &get_tag_counts() const { return m_tag_counts; }
+
+  //! Get the name of a phase.
+  //! @param phase the phase
+  //! @return the name of the phase
+  static const char *get_phase_name(Phase phase);
+
+  //! Get the peak resident set size of the process.
+  //! @return the peak RSS in bytes
+  static unsigned long get_peak_rss();
+
+  //! Get the current resident set size of the process.
+  //! @return the current RSS in bytes, or 0 if it isn't known
+  static unsigned long get_current_rss();
+
+  //! Format the statistics as text, with one line for each phase,
+  //! followed by the counts, and the number of Nodes with each tag
+  //! (in decreasing order.)
+  //! @return the formatted statistics
+  std::string format() const;
+
+  //! Format the statistics as a single line of JSON (see json_print.h
+  //! for the conventions): an object with "phases" (an object with
+  //! "wall_us" and "cpu_us" for each phase), "inputs", "tokens",
+  //! "nodes_allocated", "bytes_allocated", "tree_nodes", "max_depth",
+  //! "peak_token_bytes", "peak_string_bytes", "peak_rss", and "tags" (an array of objects with "tag", "name",
+  //! and "count".)
+  //! @return the formatted statistics
+  std::string format_json() const;
+};
+
+#endif // PARSE_STATS_H
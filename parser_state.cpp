@@ -0,0 +1,178 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "node.h"
+#include "token_table.h"
+#include "parse.tab.h"
+#include "lex.yy.h"
+#include "parser_state.h"
+#include "token_pipeline.h"
+
+ParserState::~ParserState() {
+  // free memory allocated by flex
+  if (scan_info != nullptr) {
+    yylex_destroy(scan_info);
+  }
+}
+
+Node *ParserState::get_token_node(unsigned index) {
+  const Token &tok = tokens->get_token(index);
+  Node *n = new (arena) Node(tok.tag);
+  n->set_loc(tokens->get_loc(index));
+
+  // Identifiers and string literals are interned, so that they can be
+  // compared using their symbol ids. Keywords and punctuators are also
+  // interned: there are only a few distinct ones, and interning them
+  // means each is stored only once. Other literals can't usefully be
+  // compared, and could have any number of distinct values, so they
+  // are just stored.
+  std::string_view lexeme = tokens->get_lexeme(index);
+  Interner &interner = n->get_interner();
+  unsigned sym;
+  bool ok;
+  if (tok.tag == TOK_INT_LIT || tok.tag == TOK_FP_LIT || tok.tag == TOK_CHAR_LIT) {
+    ok = interner.try_store(lexeme, sym);
+  } else {
+    ok = interner.try_intern(lexeme, sym);
+  }
+  if (ok) {
+    n->set_sym(sym);
+  } else {
+    // an exception can't be thrown through the parser, so this
+    // is reported like a syntax error, and parsing stops
+    diagnostics.add(n->get_loc(), "Too many distinct strings");
+    diagnostics.stop();
+  }
+
+  return n;
+}
+
+void ParserState::defer_body(Node *fn, Node *body) {
+  if (lazy_bodies) {
+    deferred_bodies.push_back({ fn, body, body_begin, body_end });
+  }
+}
+
+Node *ParserState::handle_declaration(Node *decl) {
+  if (decl_handler == nullptr) {
+    return decl;
+  }
+
+  (*decl_handler)(decl);
+
+  Node *placeholder = new (get_unit_arena()) Node(decl->get_tag());
+  placeholder->set_loc(decl->get_loc());
+
+  // Nothing on the parser's stack refers to the Nodes in the arena
+  // (the stack has only the unit and the placeholders for the previous
+  // declarations), so all of them can be destroyed, along with their
+  // strings. Likewise, the only token the parser might still need is
+  // its lookahead token, which is the last one it read.
+  arena->clear();
+  arena->get_interner()->clear();
+  tokens->discard_before(token_index - 1);
+
+  return placeholder;
+}
+
+namespace {
+
+// Make sure the token at pp->token_index is in the token table,
+// running the lexer if necessary.
+// Returns false if there are no more tokens to parse.
+bool have_next_token(ParserState *pp) {
+  if (pp->diagnostics.at_limit()) {
+    return false; // too many errors
+  }
+  if (pp->token_index == pp->token_end) {
+    if (pp->lexer_stopped) {
+      pp->diagnostics.stop();
+    }
+    return false; // end of the range of tokens being parsed
+  }
+
+  // if the parser has consumed all of the tokens scanned so far,
+  // run the lexer to scan the next one
+  if (pp->token_index == pp->tokens->get_num_tokens()) {
+    return (pp->pipeline != nullptr) ? pp->pipeline->next() : (yylex(pp->scan_info) != 0);
+  }
+  return true;
+}
+
+// Skip the tokens of a function body, up to (but not including)
+// the right brace matching the left brace at index lbrace.
+void skip_body(ParserState *pp, unsigned lbrace) {
+  unsigned depth = 1;
+  while (have_next_token(pp)) {
+    int tag = pp->tokens->get_token(pp->token_index).tag;
+    if (tag == TOK_LBRACE) {
+      ++depth;
+    } else if (tag == TOK_RBRACE && --depth == 0) {
+      break;
+    }
+    pp->token_index++;
+  }
+  // if the input ended first, the parser will report the error
+  // (at the end of the last token, as if the lexer had just scanned it)
+  if (pp->token_end != ~0U && pp->token_index > lbrace + 1) {
+    const Token &last = pp->tokens->get_token(pp->token_index - 1);
+    pp->cur_loc = Location(pp->tokens->get_file_id(), last.offset + last.len);
+  }
+  pp->body_begin = lbrace + 1;
+  pp->body_end = pp->token_index;
+}
+
+}
+
+int next_token(YYSTYPE *lvalp, ParserState *pp) {
+  if (pp->start_token != 0) {
+    int tag = pp->start_token;
+    pp->start_token = 0;
+    lvalp->tok = pp->token_index;
+    return tag;
+  }
+
+  if (!have_next_token(pp)) {
+    return 0; // end of input
+  }
+
+  unsigned index = pp->token_index++;
+  const Token &tok = pp->tokens->get_token(index);
+  if (pp->token_end != ~0U) {
+    // the lexer didn't just scan this token, so it didn't update
+    // the error location
+    pp->cur_loc = Location(pp->tokens->get_file_id(), tok.offset + tok.len);
+  }
+
+  int tag = tok.tag;
+
+  // At the top level, a left brace following a right parenthesis
+  // can only begin a function body. (Bodies are skipped entirely,
+  // so this never sees a left brace inside a body.) Note that
+  // skipping the body can invalidate tok, since the lexer might
+  // add tokens to the token table.
+  if (pp->lazy_bodies && tag == TOK_LBRACE && index > 0
+      && pp->tokens->get_token(index - 1).tag == TOK_RPAREN) {
+    skip_body(pp, index);
+  }
+
+  lvalp->tok = index;
+  return tag;
+}
@@ -21,27 +21,137 @@
 #ifndef PARSER_STATE_H
 #define PARSER_STATE_H
 
+#include <cstddef>
 #include <vector>
+#include <functional>
 #include "location.h"
+#include "diagnostics.h"
 class Node;
+class NodeArena;
+class TokenTable;
+class TokenRing;
+class TokenPipeline;
+union YYSTYPE;
+
+// A function body whose parsing was deferred (see
+// ParserState::lazy_bodies): the tokens of the body
+// are the ones in the range [begin, end) in the token table
+struct DeferredBody {
+  Node *fn;      // the function definition
+  Node *body;    // the (empty) placeholder for the body
+  unsigned begin, end;
+};
 
 struct ParserState {
   // To avoid depending on yyscan_t, just hard-code knowledge that
   // yyscan_t is just a typedef for void *
   void *scan_info;
 
-  // current location (used by lexer)
+  // location at which the lexer and parser report errors
   Location cur_loc;
 
   // Pointer to root of parse tree or AST
   Node *parse_tree;
 
-  // Vector of pointers to Nodes created by the lexer to represent tokens.
-  // This can be used to clean up any tokens that aren't incorporated
-  // into the tree built by the parser.
-  std::vector<Node *> tokens;
+  // Table of tokens: the lexer appends tokens to it, and the
+  // parser reads tokens from it
+  TokenTable *tokens;
+
+  // Index of the next token the parser will read
+  unsigned token_index;
+
+  // If the token table was filled in before parsing, the parser
+  // treats the token at this index as the end of the input
+  // (so that a range of the tokens can be parsed)
+  unsigned token_end;
+
+  // Errors reported by the lexer and parser (see yyerror()); when
+  // the limit is reached, the lexer and parser stop as though the
+  // end of the input had been reached
+  Diagnostics diagnostics;
+
+  // If true, the token table ends early because the lexer stopped
+  // at the error limit, so when the parser reaches token_end, it stops
+  // recording errors rather than reporting the premature end of the
+  // input as a syntax error (the lexer's errors are merged later)
+  bool lexer_stopped;
+
+  // Arena in which the parser allocates Nodes (owned by the Context)
+  NodeArena *arena;
+
+  // If not null, the arena in which the parser allocates the Nodes
+  // for the unit (but not its top-level declarations)
+  NodeArena *unit_arena;
+
+  // In streaming mode, the parser calls this function with each
+  // top-level declaration as soon as it is parsed, and then clears
+  // the arena and its Interner, and discards the declaration's tokens
+  // (see handle_declaration()), so the arena must have its own Interner
+  const std::function<void(Node *)> *decl_handler;
+
+  // In pipelined mode (see TokenPipeline), the lexer pushes tokens
+  // into this ring rather than adding them to the token table
+  TokenRing *token_ring;
+
+  // In pipelined mode, the parser gets tokens from this pipeline
+  // rather than calling the lexer
+  TokenPipeline *pipeline;
 
-  ParserState() : scan_info(nullptr), parse_tree(nullptr) { }
+  // If true, the parser skips the tokens of each function body,
+  // so that the body is parsed as an empty statement list, and
+  // records the body in deferred_bodies (see defer_body())
+  bool lazy_bodies;
+
+  // Token range of the function body skipped most recently
+  unsigned body_begin, body_end;
+
+  // Function bodies whose parsing was deferred, in source order
+  std::vector<DeferredBody> deferred_bodies;
+
+  // If nonzero, next_token() returns this token before reading
+  // the token table (this allows the parser to be started on
+  // something other than a complete unit)
+  int start_token;
+
+  ParserState() : scan_info(nullptr), parse_tree(nullptr), tokens(nullptr), token_index(0), token_end(~0U), lexer_stopped(false), arena(nullptr), unit_arena(nullptr), decl_handler(nullptr)
+                , token_ring(nullptr), pipeline(nullptr), lazy_bodies(false), body_begin(0), body_end(0), start_token(0) { }
+  ~ParserState();
+
+  // Create a Node to represent the token at the given index
+  // in the token table. The parser only creates Nodes for
+  // tokens that are actually incorporated into the tree.
+  Node *get_token_node(unsigned index);
+
+  // Called by the parser when it reduces a function definition:
+  // if function bodies are being skipped, record the body which
+  // was just skipped as a deferred body of the function
+  void defer_body(Node *fn, Node *body);
+
+  // Get the arena in which to allocate the Nodes for the unit
+  NodeArena *get_unit_arena() const { return unit_arena != nullptr ? unit_arena : arena; }
+
+  // Called by the parser when it reduces a top-level declaration.
+  // Normally, this just returns the declaration. In streaming mode,
+  // the declaration is passed to decl_handler, the arena (containing
+  // the declaration) is cleared, and an empty Node with the same tag
+  // and Location (allocated in the unit arena) is returned
+  // to take the declaration's place in the unit.
+  Node *handle_declaration(Node *decl);
 };
 
+// Get the next token for the parser from the ParserState's
+// token table, running the lexer to scan more tokens as needed.
+// The semantic value of a token is its index in the token table.
+int next_token(YYSTYPE *lvalp, ParserState *pp);
+
+// Check whether the lexer is in its initial start condition
+// (i.e., not inside a block comment); defined in lex.l
+bool lexer_in_initial_state(void *scan_info);
+
+// Prepare the lexer to scan a new input in place (the buffer must end
+// with two NUL characters, which are included in size). This allows
+// the lexer state to be reused for any number of inputs, without
+// the cost of creating a new one for each input; defined in lex.l
+void lexer_start(void *scan_info, char *buf, size_t size);
+
 #endif // PARSER_STATE_H
@@ -20,75 +20,183 @@
 
 #include "ast.h"
 #include "node.h"
-#include "cpputil.h"
+#include "grammar_symbols.h"
+#include "exceptions.h"
 #include "print_graph.h"
 
-PrintGraph::PrintGraph(Node *root)
-  : m_root(root) {
+namespace {
+
+// Write a string with the characters which are special in a
+// quoted DOT string escaped
+void write_escaped(OutputSink &out, std::string_view str) {
+  size_t start = 0;
+  for (size_t i = 0; i < str.size(); ++i) {
+    char c = str[i];
+    if (c == '"' || c == '\\' || c == '\n') {
+      out.append(str.substr(start, i - start));
+      out.append('\\');
+      out.append(c == '\n' ? 'n' : c);
+      start = i + 1;
+    }
+  }
+  out.append(str.substr(start));
+}
+
+// Write a node's id
+void write_id(OutputSink &out, unsigned id) {
+  out.append('n');
+  out.append_uint(id);
+}
+
+}
+
+PrintGraph::PrintGraph(Node *root, FILE *out)
+  : m_root(root)
+  , m_file_sink(new OutputSink(out))
+  , m_out(m_file_sink.get())
+  , m_max_depth(0)
+  , m_cluster_functions(false)
+  , m_next_id(0) {
+}
+
+PrintGraph::PrintGraph(Node *root, OutputSink &out)
+  : m_root(root)
+  , m_out(&out)
+  , m_max_depth(0)
+  , m_cluster_functions(false)
+  , m_next_id(0) {
 }
 
 PrintGraph::~PrintGraph() {
 }
 
 void PrintGraph::print() {
-  visit(m_root, "", 0);
+  // Find the subtrees to print: either the entire tree, or the
+  // function(s) with the specified name (there could be both a
+  // declaration and a definition)
+  std::vector<Node *> roots;
+  if (m_function.empty()) {
+    roots.push_back(m_root);
+  } else {
+    m_root->traverse(
+      [&](Node *n, unsigned) {
+        if (!is_function(n)) {
+          return TRAVERSE_CONTINUE;
+        }
+        if (get_function_name(n) == m_function) {
+          roots.push_back(n);
+        }
+        return TRAVERSE_SKIP_KIDS;
+      },
+      [](Node *, unsigned) {
+        return TRAVERSE_CONTINUE;
+      });
+    if (roots.empty()) {
+      RuntimeError::raise("No function named '%s'", m_function.c_str());
+    }
+  }
 
-  printf("digraph ast {\n");
-  printf("  graph [ordering=\"out\"];\n");
+  m_out->append("digraph ast {\n");
+  m_out->append("  graph [ordering=\"out\"];\n");
 
-  // output ranks so nodes are at the correct heights
-  for (std::map<std::string, int>::iterator i = m_node_levels.begin(); i != m_node_levels.end(); i++) {
-    std::string rankattr = cpputil::format("{ rank = %d; \"%s\"; }", i->second, i->first.c_str());
-    printf("  %s\n", rankattr.c_str());
+  m_next_id = 0;
+  std::vector<unsigned> path;
+  for (auto i = roots.begin(); i != roots.end(); ++i) {
+    print_subtree(*i, path);
   }
 
-  // output edges
-  for (std::map<std::string, std::vector<std::string>>::iterator i = m_edges.begin(); i != m_edges.end(); i++) {
-    for (std::vector<std::string>::iterator j = i->second.begin(); j != i->second.end(); j++) {
-      std::string edge = cpputil::format("\"%s\" -> \"%s\";", i->first.c_str(), j->c_str());
-      printf("  %s\n", edge.c_str());
-    }
+  m_out->append("}\n");
+  if (m_file_sink) {
+    m_file_sink->flush();
   }
-
-  printf("}\n");
 }
 
-int PrintGraph::visit(Node *n, const std::string &parent_name, int level) {
-  ASTTreePrint atp; // for getting node tag as string
-
+bool PrintGraph::is_function(Node *n) {
   int tag = n->get_tag();
-  std::map<int, int>::iterator i = m_node_type_count.find(tag);
-  int count = (i == m_node_type_count.end()) ? 0 : i->second;
-  m_node_type_count[tag] = count + 1;
-  std::string tag_name = atp.node_tag_to_string(tag);
-  if (tag_name == "TOK_IDENT") {
-    tag_name = "identifier";
+  return tag == NODE_function_definition_or_declaration
+      || tag == AST_FUNCTION_DEFINITION
+      || tag == AST_FUNCTION_DECLARATION;
+}
+
+std::string_view PrintGraph::get_function_name(Node *n) {
+  // In both the parse tree and the AST, the function's name
+  // is its only TOK_IDENT child
+  for (auto i = n->cbegin(); i != n->cend(); ++i) {
+    if ((*i)->get_tag() == NODE_TOK_IDENT) {
+      return (*i)->get_str_view();
+    }
   }
-  std::string node_name = cpputil::format("%s_%d", tag_name.c_str(), count);
-  std::string strval = n->get_str();
+  return std::string_view();
+}
+
+void PrintGraph::print_subtree(Node *root, std::vector<unsigned> &path) {
+  root->traverse(
+    [&](Node *n, unsigned depth) {
+      unsigned id = m_next_id++;
+      if (!path.empty()) {
+        m_out->append("  ");
+        write_id(*m_out, path.back());
+        m_out->append(" -> ");
+        write_id(*m_out, id);
+        m_out->append(";\n");
+      }
+
+      bool cluster = m_cluster_functions && is_function(n);
+      if (cluster) {
+        m_out->append("  subgraph cluster_");
+        m_out->append_uint(id);
+        m_out->append(" {\n    label=\"");
+        write_escaped(*m_out, get_function_name(n));
+        m_out->append("\";\n");
+      }
+
+      bool elided = m_max_depth > 0 && depth >= m_max_depth && n->get_num_kids() > 0;
+      print_node(n, id, elided);
+      if (elided) {
+        if (cluster) {
+          m_out->append("  }\n");
+        }
+        return TRAVERSE_SKIP_KIDS;
+      }
+
+      path.push_back(id);
+      return TRAVERSE_CONTINUE;
+    },
+    [&](Node *n, unsigned depth) {
+      // nodes whose children were skipped were never pushed
+      if (m_max_depth > 0 && depth >= m_max_depth && n->get_num_kids() > 0) {
+        return TRAVERSE_CONTINUE;
+      }
+      path.pop_back();
+      if (m_cluster_functions && is_function(n)) {
+        m_out->append("  }\n");
+      }
+      return TRAVERSE_CONTINUE;
+    });
+}
+
+void PrintGraph::print_node(Node *n, unsigned id, bool elided) {
+  m_out->append("  ");
+  write_id(*m_out, id);
+  m_out->append(" [label=\"");
+  m_out->append(get_tag_name(n->get_tag()));
+  std::string_view strval = n->get_str_view();
   if (!strval.empty()) {
-    node_name += "\\n[";
-    node_name += strval;
-    node_name += "]";
+    m_out->append("\\n[");
+    write_escaped(*m_out, strval);
+    m_out->append(']');
   }
-  m_node_levels[node_name] = level;
-  if (!parent_name.empty()) {
-    m_edges[parent_name].push_back(node_name);
-  }
-  int num_kids = n->get_num_kids();
-  int max_level = level;
-  for (int j = 0; j < num_kids; j++) {
-    int subtree_level = visit(n->get_kid(j), node_name, level + 1);
-    if (subtree_level > max_level) {
-      max_level = subtree_level;
-    }
-  }
-  return max_level;
+  m_out->append(elided ? "\", style=dashed];\n" : "\"];\n");
 }
 
-/*
-void ast_print_graph(Node *ast) {
-  PrintGraph agp(ast);
-  agp.print();
+const std::string &PrintGraph::get_tag_name(int tag) {
+  auto i = m_tag_names.find(tag);
+  if (i == m_tag_names.end()) {
+    std::string tag_name = m_tag_print.node_tag_to_string(tag);
+    if (tag_name == "TOK_IDENT") {
+      tag_name = "identifier";
+    }
+    i = m_tag_names.insert({ tag, tag_name }).first;
+  }
+  return i->second;
 }
-*/
@@ -21,27 +21,79 @@
 #ifndef PRINT_GRAPH_H
 #define PRINT_GRAPH_H
 
-#include <map>
 #include <vector>
+#include <unordered_map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <cstdio>
+#include "ast.h"
+#include "output_sink.h"
 class Node;
 
+//! Prints a tree as a graph in DOT format (for graphviz).
+//! The graph is printed in one pass over the tree, in tree order:
+//! each node is identified by its index in preorder, and is printed
+//! (along with the edge from its parent) as soon as it is entered.
+//! Other than the traversal stack, the only memory used is a stack
+//! of the ids of the nodes on the path from the root.
 class PrintGraph {
 private:
-  std::map<std::string, int> m_node_levels;
-  std::map<std::string, std::vector<std::string>> m_edges;
-  std::map<int, int> m_node_type_count;
   Node *m_root;
+  std::unique_ptr<OutputSink> m_file_sink;
+  OutputSink *m_out;
+  unsigned m_max_depth;
+  std::string m_function;
+  bool m_cluster_functions;
+  unsigned m_next_id;
+  ASTTreePrint m_tag_print;
+  std::unordered_map<int, std::string> m_tag_names;
+
+  // copy ctor and assignment operator not allowed
+  PrintGraph(const PrintGraph &);
+  PrintGraph &operator=(const PrintGraph &);
 
 public:
-  PrintGraph(Node *root);
+  PrintGraph(Node *root, FILE *out = stdout);
+  PrintGraph(Node *root, OutputSink &out);
   ~PrintGraph();
 
+  //! Limit the depth of the printed tree. The children of nodes
+  //! at the maximum depth aren't printed, and such nodes (if they
+  //! have children) are drawn with a dashed outline.
+  //! @param max_depth the maximum depth (0 for no limit)
+  void set_max_depth(unsigned max_depth) { m_max_depth = max_depth; }
+
+  //! Only print the subtree for the named function (i.e., the
+  //! function definition or declaration.) If the depth is limited,
+  //! depths are relative to the function.
+  //! @param name the name of the function (empty to print the entire tree)
+  void set_function(const std::string &name) { m_function = name; }
+
+  //! Enable or disable drawing each function's subtree in its own
+  //! cluster (labeled with the function's name.)
+  //! @param cluster_functions true if functions should be clustered
+  void set_cluster_functions(bool cluster_functions) { m_cluster_functions = cluster_functions; }
+
+  //! Print the graph. Throws RuntimeError if a function was specified
+  //! using set_function(), but the tree contains no such function.
   void print();
 
+  //! Check whether a node is a function definition or declaration
+  //! (in either a parse tree or an AST.)
+  //! @param n a Node
+  //! @return true if the node is a function definition or declaration
+  static bool is_function(Node *n);
+
+  //! Get the name of a function.
+  //! @param n a Node for which is_function() returns true
+  //! @return the name of the function
+  static std::string_view get_function_name(Node *n);
+
 private:
-  // returns maximum level
-  int visit(Node *n, const std::string &parent_name, int level);
+  void print_subtree(Node *root, std::vector<unsigned> &path);
+  void print_node(Node *n, unsigned id, bool elided);
+  const std::string &get_tag_name(int tag);
 };
 
 #endif // PRINT_GRAPH_H
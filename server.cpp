@@ -0,0 +1,252 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "exceptions.h"
+#include "cpputil.h"
+#include "context.h"
+#include "parse_stats.h"
+#include "server.h"
+
+////////////////////////////////////////////////////////////////////////
+// LatencyHistogram member functions
+////////////////////////////////////////////////////////////////////////
+
+LatencyHistogram::LatencyHistogram()
+  : m_total_us(0)
+  , m_max_us(0) {
+  for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+    m_counts[i] = 0;
+  }
+}
+
+void LatencyHistogram::record(unsigned long us) {
+  // bucket i (for i > 0) counts latencies in [2^(i-1), 2^i)
+  unsigned bucket = 0;
+  while (bucket + 1 < NUM_BUCKETS && (us >> bucket) != 0) {
+    ++bucket;
+  }
+  m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+  m_total_us.fetch_add(us, std::memory_order_relaxed);
+
+  unsigned long max = m_max_us.load(std::memory_order_relaxed);
+  while (us > max && !m_max_us.compare_exchange_weak(max, us, std::memory_order_relaxed))
+    ;
+}
+
+std::string LatencyHistogram::format() const {
+  unsigned long count = 0;
+  for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+    count += m_counts[i].load(std::memory_order_relaxed);
+  }
+  unsigned long total = m_total_us.load(std::memory_order_relaxed);
+
+  std::string result = cpputil::format("requests: %lu, mean latency: %.1f us, max latency: %lu us\n",
+                                       count, count > 0 ? double(total) / count : 0.0,
+                                       m_max_us.load(std::memory_order_relaxed));
+  for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+    unsigned long n = m_counts[i].load(std::memory_order_relaxed);
+    if (n == 0) {
+      continue;
+    }
+    unsigned long lo = (i == 0) ? 0 : 1UL << (i - 1);
+    if (i + 1 == NUM_BUCKETS) {
+      result += cpputil::format("  >= %lu us: %lu\n", lo, n);
+    } else {
+      result += cpputil::format("  %lu-%lu us: %lu\n", lo, 1UL << i, n);
+    }
+  }
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Server member functions
+////////////////////////////////////////////////////////////////////////
+
+Server::Server(unsigned num_workers, Handler handler)
+  : m_handler(handler)
+  , m_shutdown(false)
+  , m_listen_fd(-1) {
+  for (unsigned i = 0; i < num_workers; ++i) {
+    m_contexts.emplace_back(new Context);
+  }
+}
+
+Server::~Server() {
+}
+
+void Server::serve_stream(FILE *in, FILE *out) {
+  serve_connection(*m_contexts[0], in, out);
+}
+
+void Server::serve_socket(const std::string &path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    RuntimeError::raise("Socket path '%s' is too long", path.c_str());
+  }
+  strcpy(addr.sun_path, path.c_str());
+
+  m_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (m_listen_fd < 0) {
+    RuntimeError::raise("Couldn't create socket: %s", strerror(errno));
+  }
+  unlink(path.c_str());
+  if (bind(m_listen_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0
+      || listen(m_listen_fd, SOMAXCONN) < 0) {
+    int err = errno;
+    close(m_listen_fd);
+    m_listen_fd = -1;
+    RuntimeError::raise("Couldn't listen on '%s': %s", path.c_str(), strerror(err));
+  }
+
+  // a client closing its connection early shouldn't kill the server
+  signal(SIGPIPE, SIG_IGN);
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < m_contexts.size(); ++i) {
+    workers.emplace_back(&Server::accept_connections, this, i);
+  }
+  for (auto i = workers.begin(); i != workers.end(); ++i) {
+    i->join();
+  }
+
+  close(m_listen_fd);
+  m_listen_fd = -1;
+  unlink(path.c_str());
+}
+
+// Handle the requests on one connection. Returns false if
+// a shutdown request was received, true otherwise.
+bool Server::serve_connection(Context &ctx, FILE *in, FILE *out) {
+  char *line = nullptr;
+  size_t line_size = 0;
+  ssize_t len;
+  std::string reply;
+  bool keep_serving = true;
+
+  while ((len = getline(&line, &line_size, in)) >= 0) {
+    auto start = std::chrono::steady_clock::now();
+
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+      --len;
+    }
+    std::string request(line, size_t(len));
+    size_t space = request.find(' ');
+    std::string command = request.substr(0, space);
+    std::string arg = (space == std::string::npos) ? "" : request.substr(space + 1);
+    if (command.empty()) {
+      continue;
+    }
+
+    reply.clear();
+    bool ok = true;
+    bool timed = false;
+    if (command == "quit" || command == "shutdown") {
+      keep_serving = (command == "quit");
+    } else if (command == "stats") {
+      reply = m_latency.format();
+      reply += cpputil::format("rss: %lu bytes\n", ParseStats::get_current_rss());
+    } else {
+      timed = true;
+      try {
+        ok = m_handler(ctx, command, arg, reply);
+      } catch (std::exception &ex) {
+        ok = false;
+        reply = std::string(ex.what()) + "\n";
+      }
+    }
+
+    fprintf(out, "%s %zu\n", ok ? "OK" : "ERROR", reply.size());
+    fwrite(reply.data(), 1, reply.size(), out);
+    fflush(out);
+
+    if (timed) {
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      m_latency.record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+
+      // Nothing is kept from one request to the next except the
+      // Context's memory (for reuse): the request's tree and its
+      // strings are discarded now that the reply has been sent
+      ctx.clear_ast();
+#ifdef __GLIBC__
+      // Return the memory freed by the request to the OS. Otherwise,
+      // once glibc has raised its mmap threshold (which it does when
+      // a large block is freed), the request's large temporary buffers
+      // (e.g., for a tree in binary format) stay resident.
+      malloc_trim(0);
+#endif
+    }
+    if (command == "quit" || command == "shutdown") {
+      break;
+    }
+  }
+
+  free(line);
+  return keep_serving;
+}
+
+// Worker thread function: accept connections and handle
+// their requests until the server is shut down
+void Server::accept_connections(unsigned worker) {
+  while (!m_shutdown.load()) {
+    int fd = accept(m_listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // the listening socket was shut down (or
+      // something is seriously wrong)
+      break;
+    }
+
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    bool keep_serving = true;
+    if (in != nullptr && out != nullptr) {
+      keep_serving = serve_connection(*m_contexts[worker], in, out);
+    }
+    if (in != nullptr) {
+      fclose(in);
+    } else {
+      close(fd);
+    }
+    if (out != nullptr) {
+      fclose(out);
+    }
+
+    if (!keep_serving) {
+      // wake up the other workers, which are waiting in accept()
+      m_shutdown.store(true);
+      shutdown(m_listen_fd, SHUT_RDWR);
+    }
+  }
+}
@@ -0,0 +1,144 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <cstdio>
+class Context;
+
+//! A LatencyHistogram counts request latencies in buckets whose
+//! bounds are powers of two microseconds. It may be updated from
+//! multiple threads.
+class LatencyHistogram {
+public:
+  //! Number of buckets: the last bucket counts all latencies
+  //! of 2^(NUM_BUCKETS-2) microseconds or longer.
+  static const unsigned NUM_BUCKETS = 24;
+
+private:
+  std::atomic<unsigned long> m_counts[NUM_BUCKETS];
+  std::atomic<unsigned long> m_total_us;
+  std::atomic<unsigned long> m_max_us;
+
+  // copy ctor and assignment operator not allowed
+  LatencyHistogram(const LatencyHistogram &);
+  LatencyHistogram &operator=(const LatencyHistogram &);
+
+public:
+  LatencyHistogram();
+
+  //! Record a latency.
+  //! @param us the latency in microseconds
+  void record(unsigned long us);
+
+  //! Format the histogram as text: the number of requests and
+  //! their mean and maximum latency, followed by one line for each
+  //! nonempty bucket.
+  //! @return the formatted histogram
+  std::string format() const;
+};
+
+//! A Server handles requests for the results of processing
+//! source files, using a fixed pool of worker threads, each with
+//! its own Context. Since the Contexts (and their memory) are
+//! reused, requests don't pay the cost of starting up.
+//!
+//! Each request is one line of text, consisting of a command and
+//! an argument (e.g., `tree foo.c`). Each reply consists of a line
+//! with `OK` or `ERROR` and the length of the payload in bytes,
+//! followed by the payload. The Server handles the `stats` command
+//! (reply with the latency histogram and the current RSS), `quit`
+//! (close the connection) and `shutdown` (stop the server). Other
+//! commands are passed to the handler function. After each request,
+//! the Context's tree (and its strings) are discarded, so the memory
+//! used by the Server doesn't grow with the number of requests.
+//!
+//! Note that the Server does no access control: the argument of
+//! a request is typically a filename, and any file which the server
+//! process can read may be opened and parsed on behalf of any client
+//! which can connect to it (or write to its input). The socket should
+//! only be accessible to trusted users.
+class Server {
+public:
+  //! Type of the function which handles requests. It is called as
+  //! `handler(ctx, command, arg, reply)`, and returns true if the
+  //! request succeeded (with the result in `reply`), or false if it
+  //! failed (with an error message in `reply`.)
+  typedef std::function<bool(Context &, const std::string &, const std::string &, std::string &)> Handler;
+
+private:
+  std::vector<std::unique_ptr<Context>> m_contexts;
+  Handler m_handler;
+  LatencyHistogram m_latency;
+  std::atomic<bool> m_shutdown;
+  int m_listen_fd;
+
+  // copy ctor and assignment operator not allowed
+  Server(const Server &);
+  Server &operator=(const Server &);
+
+public:
+  //! Constructor.
+  //! @param num_workers the number of worker threads (and Contexts)
+  //! @param handler the function which handles requests
+  Server(unsigned num_workers, Handler handler);
+
+  ~Server();
+
+  //! Get the number of worker threads.
+  //! @return the number of worker threads
+  unsigned get_num_workers() const { return unsigned(m_contexts.size()); }
+
+  //! Get the Context used by a worker thread (e.g., to configure it.)
+  //! @param worker the index of the worker thread
+  //! @return the worker's Context
+  Context &get_context(unsigned worker) { return *m_contexts[worker]; }
+
+  //! Get the latency histogram.
+  //! @return the latency histogram
+  const LatencyHistogram &get_latency() const { return m_latency; }
+
+  //! Handle requests read from one stream, writing the replies to
+  //! another (e.g., stdin and stdout), using the first worker's
+  //! Context. Returns at the end of the input, or when a `quit`
+  //! or `shutdown` request is received.
+  //! @param in the stream to read requests from
+  //! @param out the stream to write replies to
+  void serve_stream(FILE *in, FILE *out);
+
+  //! Listen for connections on a Unix domain socket, and handle
+  //! requests until a `shutdown` request is received. Each worker
+  //! thread accepts connections and handles their requests.
+  //! Throws RuntimeError if the socket can't be created.
+  //! @param path the path of the socket (which is replaced if it exists)
+  void serve_socket(const std::string &path);
+
+private:
+  bool serve_connection(Context &ctx, FILE *in, FILE *out);
+  void accept_connections(unsigned worker);
+};
+
+#endif // SERVER_H
@@ -0,0 +1,101 @@
+#! /usr/bin/env ruby
+
+# Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included
+# in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+# OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+# ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+# OTHER DEALINGS IN THE SOFTWARE.
+
+# Check that the memory used by nearly_c in server mode doesn't grow
+# with the number of requests: each input file is requested ROUNDS
+# times, and the server's RSS after the first round of requests is
+# compared with its RSS at the end. Each round also requests a
+# generated file whose identifiers are different in every round,
+# so state kept from one request to the next (e.g., strings) shows
+# up as growth.
+#
+# Usage: server_check.rb EXE ROUNDS FILE...
+
+require 'tempfile'
+
+# The RSS may grow this much (e.g., because of heap fragmentation)
+SLACK = 1024 * 1024
+
+# Number of functions in each generated file
+NUM_GENERATED = 2000
+
+if ARGV.size < 3 || ARGV[1].to_i < 2
+  STDERR.puts "Usage: server_check.rb EXE ROUNDS FILE..."
+  STDERR.puts "(ROUNDS must be at least 2)"
+  exit 1
+end
+exe = ARGV[0]
+rounds = ARGV[1].to_i
+files = ARGV[2..-1]
+
+# Send a request, and return the reply's status and payload
+def request(server, req)
+  server.puts req
+  server.flush
+  status, len = server.gets.split
+  return status, server.read(len.to_i)
+end
+
+def get_rss(server)
+  status, payload = request(server, 'stats')
+  m = /^rss: (\d+) bytes$/.match(payload)
+  raise "No RSS in stats reply" if status != 'OK' || m.nil?
+  return m[1].to_i
+end
+
+# Write a file whose identifiers are unique to the given round
+def generate(file, round)
+  file.rewind
+  file.truncate(0)
+  (1..NUM_GENERATED).each do |i|
+    file.puts "int f_#{round}_#{i}(int a_#{round}_#{i}) { return a_#{round}_#{i} + #{round * NUM_GENERATED + i}; }"
+  end
+  file.flush
+end
+
+first_rss = nil
+last_rss = nil
+generated = Tempfile.new(['server_check', '.c'])
+IO.popen([exe, '--server', :err => File::NULL], 'r+') do |server|
+  (1..rounds).each do |round|
+    generate(generated, round)
+    # (the generated file's tree is large, so it is
+    # requested in binary format rather than as text)
+    reqs = files.map { |f| "tree #{f}" } + ["binary #{generated.path}"]
+    reqs.each do |req|
+      # replies for inputs with errors are fine, but
+      # the server must still be handling requests
+      status, payload = request(server, req)
+      raise "Bad reply for '#{req}'" if status.nil? || payload.nil?
+    end
+    first_rss = get_rss(server) if round == 1
+  end
+  last_rss = get_rss(server)
+  request(server, 'shutdown')
+end
+generated.close!
+
+puts "RSS after 1 round: #{first_rss} bytes, after #{rounds} rounds: #{last_rss} bytes"
+if last_rss > first_rss + SLACK
+  puts "RSS grew by #{last_rss - first_rss} bytes"
+  exit 1
+end
@@ -0,0 +1,173 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "exceptions.h"
+#include "source_buffer.h"
+
+namespace {
+
+// RAII wrapper for a file descriptor
+struct FileDescriptor {
+  int fd;
+
+  FileDescriptor(int fd_) : fd(fd_) { }
+  ~FileDescriptor() { if (fd >= 0) { close(fd); } }
+};
+
+const size_t READ_CHUNK_SIZE = 65536;
+
+}
+
+SourceBuffer::SourceBuffer()
+  : m_data(nullptr)
+  , m_size(0)
+  , m_map_size(0)
+  , m_capacity(0) {
+}
+
+SourceBuffer::~SourceBuffer() {
+  release();
+}
+
+void SourceBuffer::load_file(const std::string &filename) {
+  release();
+
+  FileDescriptor in(open(filename.c_str(), O_RDONLY));
+  if (in.fd < 0) {
+    RuntimeError::raise("Couldn't open '%s'", filename.c_str());
+  }
+
+  // Memory-map regular files. If the input isn't a regular file,
+  // or if it can't be mapped for some reason, fall back to reading it.
+  struct stat st;
+  if (fstat(in.fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0
+      && map_file(in.fd, size_t(st.st_size))) {
+    return;
+  }
+
+  read_file(in.fd, filename);
+}
+
+void SourceBuffer::load_text(std::string_view text) {
+  // reuse the heap buffer if possible
+  if (m_map_size > 0 || m_capacity < text.size() + 2) {
+    release();
+    size_t capacity = text.size() + 2;
+    m_data = static_cast<char *>(malloc(capacity));
+    if (m_data == nullptr) {
+      throw std::bad_alloc();
+    }
+    m_capacity = capacity;
+  }
+
+  memcpy(m_data, text.data(), text.size());
+  m_data[text.size()] = '\0';
+  m_data[text.size() + 1] = '\0';
+  m_size = text.size();
+}
+
+bool SourceBuffer::map_file(int fd, size_t size) {
+  // flex needs two NUL bytes after the text. The part of the last
+  // page of a file mapping past the end of the file is zero-filled,
+  // but if the file size is (nearly) a multiple of the page size
+  // there is no such part, so we first reserve a zero-filled anonymous
+  // region large enough for the text and the NUL bytes, and then map
+  // the file over the beginning of it. The mapping is private,
+  // so flex's temporary modifications of the text don't affect the file.
+  size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+  size_t map_size = (size + 2 + page_size - 1) / page_size * page_size;
+
+  void *region = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    return false;
+  }
+
+  void *text = mmap(region, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_FIXED, fd, 0);
+  if (text == MAP_FAILED) {
+    munmap(region, map_size);
+    return false;
+  }
+
+  // the lexer reads the text from beginning to end
+  madvise(region, map_size, MADV_SEQUENTIAL);
+
+  m_data = static_cast<char *>(region);
+  m_size = size;
+  m_map_size = map_size;
+  return true;
+}
+
+void SourceBuffer::read_file(int fd, const std::string &filename) {
+  size_t capacity = READ_CHUNK_SIZE;
+  char *buf = static_cast<char *>(malloc(capacity));
+  size_t size = 0;
+
+  for (;;) {
+    // always leave room for the trailing NUL bytes
+    if (capacity - size < READ_CHUNK_SIZE + 2) {
+      capacity *= 2;
+      buf = static_cast<char *>(realloc(buf, capacity));
+    }
+    ssize_t n = read(fd, buf + size, READ_CHUNK_SIZE);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      free(buf);
+      RuntimeError::raise("Error reading '%s': %s", filename.c_str(), strerror(errno));
+    }
+    if (n == 0) {
+      break;
+    }
+    size += size_t(n);
+  }
+
+  buf[size] = '\0';
+  buf[size + 1] = '\0';
+
+  m_data = buf;
+  m_size = size;
+  m_map_size = 0;
+  m_capacity = capacity;
+}
+
+void SourceBuffer::release() {
+  if (m_data != nullptr) {
+    if (m_map_size > 0) {
+      munmap(m_data, m_map_size);
+    } else {
+      free(m_data);
+    }
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_map_size = 0;
+  m_capacity = 0;
+}
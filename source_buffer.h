@@ -0,0 +1,96 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+//! A SourceBuffer holds the complete text of an input source file
+//! in memory, laid out the way flex's `yy_scan_buffer()` function
+//! requires (i.e., followed by two NUL bytes), so that the lexer
+//! can scan the text in place rather than copying it through its
+//! own input buffer.
+//!
+//! Regular files are memory-mapped. Other kinds of input
+//! (pipes, terminals, etc.) can't be mapped, so they are read
+//! into a heap buffer. Source text in memory is copied into a heap
+//! buffer, which is reused (if it is large enough) by the next
+//! call to `load_text`.
+class SourceBuffer {
+private:
+  char *m_data;
+  size_t m_size;
+  size_t m_map_size;
+  size_t m_capacity; // of the heap buffer (if the text isn't mapped)
+
+  // copy ctor and assignment operator not allowed
+  SourceBuffer(const SourceBuffer &);
+  SourceBuffer &operator=(const SourceBuffer &);
+
+public:
+  //! Constructor. The SourceBuffer will be empty until
+  //! `load_file` is called.
+  SourceBuffer();
+
+  ~SourceBuffer();
+
+  //! Load the contents of a source file. Any previously loaded
+  //! contents are discarded. Throws RuntimeError if the file
+  //! can't be opened or read.
+  //! @param filename the name of the source file
+  void load_file(const std::string &filename);
+
+  //! Load source text from memory. Any previously loaded
+  //! contents are discarded. The text is copied, since flex
+  //! needs to be able to modify it.
+  //! @param text the source text
+  void load_text(std::string_view text);
+
+  //! Get a pointer to the start of the buffer. The buffer is
+  //! writable, since flex temporarily modifies the text while
+  //! scanning it.
+  //! @return pointer to the start of the buffer
+  char *get_data() const { return m_data; }
+
+  //! Get the size of the source text (not counting the
+  //! trailing NUL bytes).
+  //! @return the size of the source text
+  size_t get_size() const { return m_size; }
+
+  //! Get the size of the buffer to pass to `yy_scan_buffer()`,
+  //! which includes the two trailing NUL bytes.
+  //! @return the size of the buffer including the trailing NUL bytes
+  size_t get_scan_size() const { return m_size + 2; }
+
+  //! Check whether the source text is memory-mapped.
+  //! @return true if the source text is memory-mapped, false if
+  //!         it was read into a heap buffer
+  bool is_mapped() const { return m_map_size > 0; }
+
+private:
+  bool map_file(int fd, size_t size);
+  void read_file(int fd, const std::string &filename);
+  void release();
+};
+
+#endif // SOURCE_BUFFER_H
@@ -0,0 +1,61 @@
+#! /usr/bin/env ruby
+
+# Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included
+# in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+# OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+# ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+# OTHER DEALINGS IN THE SOFTWARE.
+
+# Check that the memory nearly_c uses for tokens and strings when
+# parsing in streaming mode (-S) doesn't grow with the size of the
+# input: the peak amounts reported by --stats for a small input and
+# a large one (with declarations of the same sizes, e.g., generated
+# by gen_bench_input.rb) are compared.
+#
+# Usage: stream_check.rb EXE SMALL_FILE LARGE_FILE
+
+require 'open3'
+
+# The peak amounts for the large input may be this much
+# larger (e.g., because it has longer identifiers)
+MAX_RATIO = 1.5
+
+if ARGV.size != 3
+  STDERR.puts "Usage: stream_check.rb EXE SMALL_FILE LARGE_FILE"
+  exit 1
+end
+exe, small, large = ARGV
+
+# Parse a file in streaming mode, and return the peak
+# token and string memory
+def get_peaks(exe, file)
+  _, err, status = Open3.capture3(exe, '-S', '--stats', file)
+  raise "Couldn't parse #{file}" if !status.success?
+  tokens = /^peak token memory: (\d+) bytes$/.match(err)
+  strings = /^peak string memory: (\d+) bytes$/.match(err)
+  raise "No memory statistics for #{file}" if tokens.nil? || strings.nil?
+  return tokens[1].to_i, strings[1].to_i
+end
+
+small_tokens, small_strings = get_peaks(exe, small)
+large_tokens, large_strings = get_peaks(exe, large)
+puts "#{small}: #{small_tokens} bytes for tokens, #{small_strings} bytes for strings"
+puts "#{large}: #{large_tokens} bytes for tokens, #{large_strings} bytes for strings"
+if large_tokens > small_tokens * MAX_RATIO || large_strings > small_strings * MAX_RATIO
+  puts "Memory for tokens or strings grew with the size of the input"
+  exit 1
+end
@@ -0,0 +1,7 @@
+int count_down(int x) {
+  do {} while (x);
+  do {
+    x = x - 1;
+  } while (x > 0);
+  return x;
+}
@@ -0,0 +1,11 @@
+/*
+ * With --max-errors 1, the lexer stops at the unrecognized character.
+ * The only error reported (in every mode, including -P and -D N) should
+ * be the unrecognized character, not a syntax error at the end of the
+ * tokens preceding it.
+ */
+int main(void) {
+  int x;
+  x = 1 @ ;
+  return x;
+}
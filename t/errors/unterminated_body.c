@@ -0,0 +1,10 @@
+/*
+ * The body of the function has no closing brace. Whether the body
+ * is parsed or skipped (-B), and in every mode (including -P and
+ * -D N), the error should be reported at the end of the input
+ * (rather than the parser waiting forever for another token.)
+ */
+int f(int x) {
+  int y;
+  y = x + 1;
+  return y;
@@ -0,0 +1,121 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <exception>
+#include <cassert>
+#include "thread_pool.h"
+
+namespace {
+
+// Queue of task indices belonging to one worker
+struct TaskQueue {
+  std::mutex lock;
+  std::deque<unsigned> tasks;
+
+  // the owning worker takes tasks from the front, so tasks
+  // are (roughly) executed in order
+  bool take(unsigned &task) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (tasks.empty()) {
+      return false;
+    }
+    task = tasks.front();
+    tasks.pop_front();
+    return true;
+  }
+
+  // other workers steal tasks from the back
+  bool steal(unsigned &task) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (tasks.empty()) {
+      return false;
+    }
+    task = tasks.back();
+    tasks.pop_back();
+    return true;
+  }
+};
+
+}
+
+ThreadPool::ThreadPool(unsigned num_threads)
+  : m_num_threads(num_threads) {
+  assert(num_threads > 0);
+}
+
+ThreadPool::~ThreadPool() {
+}
+
+void ThreadPool::run(unsigned num_tasks, const std::function<void(unsigned, unsigned)> &fn) {
+  std::vector<std::unique_ptr<TaskQueue>> queues;
+  for (unsigned i = 0; i < m_num_threads; ++i) {
+    queues.emplace_back(new TaskQueue);
+  }
+  for (unsigned i = 0; i < num_tasks; ++i) {
+    queues[i % m_num_threads]->tasks.push_back(i);
+  }
+
+  std::mutex error_lock;
+  std::exception_ptr error;
+
+  auto worker_fn = [&](unsigned worker) {
+    for (;;) {
+      // take a task from our own queue, or else try to steal one;
+      // since no tasks are added once the batch starts, if there
+      // are no tasks to steal, the worker is done
+      unsigned task;
+      bool found = queues[worker]->take(task);
+      for (unsigned i = 1; !found && i < m_num_threads; ++i) {
+        found = queues[(worker + i) % m_num_threads]->steal(task);
+      }
+      if (!found) {
+        return;
+      }
+
+      try {
+        fn(worker, task);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(error_lock);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+  };
+
+  // the calling thread acts as worker 0
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < m_num_threads; ++i) {
+    threads.emplace_back(worker_fn, i);
+  }
+  worker_fn(0);
+  for (auto i = threads.begin(); i != threads.end(); ++i) {
+    i->join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
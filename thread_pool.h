@@ -0,0 +1,63 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <functional>
+
+//! A ThreadPool executes a batch of independent tasks using a fixed
+//! number of worker threads. Tasks are identified by an index.
+//! Each worker has its own queue of tasks: the tasks are initially
+//! distributed among the queues round-robin, and a worker whose queue
+//! is empty steals tasks from the other workers' queues, so the
+//! workers stay busy even if some tasks take much longer than others.
+class ThreadPool {
+private:
+  unsigned m_num_threads;
+
+  // copy ctor and assignment operator not allowed
+  ThreadPool(const ThreadPool &);
+  ThreadPool &operator=(const ThreadPool &);
+
+public:
+  //! Constructor.
+  //! @param num_threads number of worker threads (must be at least 1)
+  ThreadPool(unsigned num_threads);
+
+  ~ThreadPool();
+
+  //! Get the number of worker threads.
+  //! @return the number of worker threads
+  unsigned get_num_threads() const { return m_num_threads; }
+
+  //! Execute a batch of tasks, and wait for all of them to complete.
+  //! The task function is called as `fn(worker, task)`, where `worker`
+  //! is the index of the worker thread executing the task (from 0 to
+  //! `get_num_threads() - 1`), and `task` is the index of the task.
+  //! Each task is executed exactly once. If a task throws an exception,
+  //! the remaining tasks are still executed, and then the first
+  //! exception thrown is rethrown.
+  //! @param num_tasks the number of tasks
+  //! @param fn the task function
+  void run(unsigned num_tasks, const std::function<void(unsigned, unsigned)> &fn);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,101 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "token_table.h"
+#include "parse.tab.h"
+#include "lex.yy.h"
+#include "token_pipeline.h"
+
+TokenPipeline::TokenPipeline(ParserState *pp)
+  : m_pp(pp)
+  , m_failed(false)
+  , m_done(false) {
+  // The lexer gets its own ParserState, so that it can track
+  // the location for reporting lexical errors independently of
+  // the parser. It pushes Tokens into the ring rather than adding
+  // them to the TokenTable (which belongs to the parser thread.)
+  m_lex_state.cur_loc = pp->cur_loc;
+  m_lex_state.tokens = pp->tokens;
+  m_lex_state.token_ring = &m_ring;
+  m_lex_state.diagnostics.set_limit(pp->diagnostics.get_limit());
+  yyset_extra(&m_lex_state, pp->scan_info);
+
+  m_thread = std::thread(&TokenPipeline::scan, this);
+}
+
+TokenPipeline::~TokenPipeline() {
+  // If the parser stopped early (e.g., because of a syntax
+  // error), the lexer thread might be waiting for room in
+  // the ring, so close it
+  m_ring.close();
+  m_thread.join();
+
+  m_pp->diagnostics.merge(m_lex_state.diagnostics);
+
+  yyset_extra(m_pp, m_pp->scan_info);
+}
+
+bool TokenPipeline::next() {
+  // The parser can ask for another token after the end of the input
+  // (e.g., after skipping an unterminated function body), but popping
+  // from the ring would wait forever, since the lexer thread is done
+  if (m_done) {
+    return false;
+  }
+
+  Token tok = m_ring.pop();
+  if (tok.tag == END_TAG) {
+    m_done = true;
+    return false;
+  }
+  if (tok.tag == ERROR_TAG) {
+    m_failed = true;
+    m_done = true;
+    return false;
+  }
+  if (tok.tag == LIMIT_TAG) {
+    m_pp->diagnostics.stop();
+    m_done = true;
+    return false;
+  }
+
+  TokenTable *tokens = m_pp->tokens;
+  tokens->add(tok.tag, tok.offset, tok.len);
+
+  // syntax errors are reported at the end of the most recent token
+  m_pp->cur_loc = Location(tokens->get_file_id(), tok.offset + tok.len);
+
+  return true;
+}
+
+// Lexer thread function
+void TokenPipeline::scan() {
+  try {
+    while (yylex(m_pp->scan_info) != 0)
+      ;
+    bool stopped = m_lex_state.diagnostics.at_limit();
+    m_ring.push({ stopped ? LIMIT_TAG : END_TAG, 0, 0 });
+  } catch (...) {
+    // the error is rethrown in the parser thread when it
+    // reaches this point in the token stream (see get_error())
+    m_error = std::current_exception();
+    m_ring.push({ ERROR_TAG, 0, 0 });
+  }
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef TOKEN_PIPELINE_H
+#define TOKEN_PIPELINE_H
+
+#include <thread>
+#include <exception>
+#include "token_ring.h"
+#include "parser_state.h"
+
+//! A TokenPipeline runs the lexer in a separate thread, so that
+//! scanning and parsing overlap. The lexer thread pushes Tokens
+//! into a TokenRing, and the parser thread pops them (see
+//! next_token()) and adds them to the TokenTable. The Tokens,
+//! reach the parser in the same order as they would if the lexer
+//! were called synchronously. Errors reported by the lexer are
+//! recorded by the lexer thread, and are merged with the parser's
+//! errors (in source order) when the TokenPipeline is destroyed.
+class TokenPipeline {
+private:
+  TokenRing m_ring;
+  ParserState *m_pp;
+  ParserState m_lex_state;
+  std::exception_ptr m_error;
+  bool m_failed;
+  bool m_done; // the lexer thread's last Token has been popped
+  std::thread m_thread;
+
+  // copy ctor and assignment operator not allowed
+  TokenPipeline(const TokenPipeline &);
+  TokenPipeline &operator=(const TokenPipeline &);
+
+public:
+  //! Tag of the Token which marks the end of the input.
+  static const int END_TAG = 0;
+
+  //! Tag of the Token which indicates that the lexer
+  //! thread failed with an exception.
+  static const int ERROR_TAG = -1;
+
+  //! Tag of the Token which indicates that the lexer stopped
+  //! because it reached the error limit.
+  static const int LIMIT_TAG = -2;
+
+  //! Constructor. Starts the lexer thread.
+  //! @param pp the parser's ParserState (its lexer state must be
+  //!           initialized and ready to scan the input)
+  TokenPipeline(ParserState *pp);
+
+  //! Destructor. Stops the lexer thread if it hasn't finished, and
+  //! adds the errors reported by the lexer to the parser's ParserState.
+  ~TokenPipeline();
+
+  //! Get the next token from the lexer thread and add it to the
+  //! TokenTable. (Called from the parser thread.)
+  //! If the lexer stopped at the error limit, the parser stops
+  //! recording errors (see Diagnostics::stop()), since the end of
+  //! the input it sees isn't the real end of the input.
+  //! Once the end of the input is reached (or the lexer thread fails
+  //! or stops), every subsequent call returns false immediately, since
+  //! the lexer thread won't push any more Tokens.
+  //! @return true if a token was added, false at the end of the input
+  //!         (or if the lexer thread failed or stopped)
+  bool next();
+
+  //! Get the exception which made the lexer thread fail, if the
+  //! parser reached the point at which it failed. (Called from the
+  //! parser thread, which should rethrow it once the parser returns,
+  //! rather than throwing it through the parser.)
+  //! @return the exception, or null if the lexer thread didn't fail
+  std::exception_ptr get_error() const { return m_failed ? m_error : nullptr; }
+
+private:
+  void scan();
+};
+
+#endif // TOKEN_PIPELINE_H
@@ -0,0 +1,103 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef TOKEN_RING_H
+#define TOKEN_RING_H
+
+#include <atomic>
+#include <thread>
+#include "token_table.h"
+
+//! A bounded lock-free single-producer/single-consumer queue
+//! of Tokens. It is used to pass Tokens from a lexer thread to a
+//! parser thread. Exactly one thread may call push(), and exactly
+//! one (other) thread may call pop() and close().
+class TokenRing {
+public:
+  //! Number of Tokens the ring can hold (must be a power of 2).
+  static const unsigned CAPACITY = 4096;
+
+private:
+  Token m_slots[CAPACITY];
+
+  // The head and tail are kept on separate cache lines, so the
+  // producer and consumer don't interfere with each other
+  alignas(64) std::atomic<unsigned> m_head; // next slot to pop
+  alignas(64) std::atomic<unsigned> m_tail; // next slot to push
+  alignas(64) std::atomic<bool> m_closed;
+
+  // copy ctor and assignment operator not allowed
+  TokenRing(const TokenRing &);
+  TokenRing &operator=(const TokenRing &);
+
+public:
+  TokenRing() : m_head(0), m_tail(0), m_closed(false) { }
+
+  //! Add a Token to the ring, waiting until there is room for it.
+  //! (Called by the producer.)
+  //! @param tok the Token to add
+  //! @return true if the Token was added, false if the
+  //!         ring was closed by the consumer
+  bool push(const Token &tok) {
+    unsigned tail = m_tail.load(std::memory_order_relaxed);
+    unsigned spins = 0;
+    for (;;) {
+      if (m_closed.load(std::memory_order_relaxed)) {
+        return false;
+      }
+      if (tail - m_head.load(std::memory_order_acquire) < CAPACITY) {
+        break;
+      }
+      backoff(spins);
+    }
+    m_slots[tail & (CAPACITY - 1)] = tok;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  //! Remove a Token from the ring, waiting until one is available.
+  //! (Called by the consumer.)
+  //! @return the Token removed from the ring
+  Token pop() {
+    unsigned head = m_head.load(std::memory_order_relaxed);
+    unsigned spins = 0;
+    while (m_tail.load(std::memory_order_acquire) == head) {
+      backoff(spins);
+    }
+    Token tok = m_slots[head & (CAPACITY - 1)];
+    m_head.store(head + 1, std::memory_order_release);
+    return tok;
+  }
+
+  //! Close the ring, so that the producer stops waiting for room
+  //! to add Tokens. (Called by the consumer if it won't be
+  //! removing any more Tokens.)
+  void close() { m_closed.store(true, std::memory_order_relaxed); }
+
+private:
+  // Wait briefly: spin for a while, then start yielding the CPU
+  static void backoff(unsigned &spins) {
+    if (++spins > 64) {
+      std::this_thread::yield();
+    }
+  }
+};
+
+#endif // TOKEN_RING_H
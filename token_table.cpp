@@ -0,0 +1,44 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "token_table.h"
+
+TokenTable::TokenTable()
+  : m_src(nullptr)
+  , m_file_id(0)
+  , m_base(0) {
+}
+
+TokenTable::~TokenTable() {
+}
+
+void TokenTable::reset(const char *src, unsigned file_id) {
+  m_src = src;
+  m_file_id = file_id;
+  m_base = 0;
+  m_tokens.clear();
+}
+
+void TokenTable::discard_before(unsigned index) {
+  if (index > m_base) {
+    m_tokens.erase(m_tokens.begin(), m_tokens.begin() + (index - m_base));
+    m_base = index;
+  }
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef TOKEN_TABLE_H
+#define TOKEN_TABLE_H
+
+#include <vector>
+#include <string_view>
+#include "location.h"
+
+//! A Token is a compact record describing one token produced
+//! by the lexer. The lexeme isn't stored in the Token: instead,
+//! the Token records where the lexeme is in the source text
+//! (which also determines the Token's source Location.)
+struct Token {
+  //! the token's tag value (e.g., TOK_IDENT)
+  int tag;
+
+  //! offset of the lexeme in the source text
+  unsigned offset;
+
+  //! length of the lexeme
+  unsigned len;
+};
+
+//! A TokenTable is a contiguous array of Tokens scanned from
+//! a single source text. Lexemes are returned as views into the
+//! source text, so the source text must outlive the TokenTable
+//! (or at least any use of its lexemes.)
+//!
+//! The Tokens at the beginning of the table can be discarded once
+//! they are no longer needed (see discard_before()), e.g., when
+//! parsing in streaming mode. The remaining Tokens keep their indices.
+class TokenTable {
+private:
+  const char *m_src;
+  unsigned m_file_id;
+  unsigned m_base; // index of m_tokens[0]
+  std::vector<Token> m_tokens;
+
+  // copy ctor and assignment operator not allowed
+  TokenTable(const TokenTable &);
+  TokenTable &operator=(const TokenTable &);
+
+public:
+  TokenTable();
+  ~TokenTable();
+
+  //! Discard all Tokens and set the source text that
+  //! Tokens subsequently added will refer to.
+  //! @param src pointer to the beginning of the source text
+  //! @param file_id the source file's id in the FileTable
+  void reset(const char *src, unsigned file_id);
+
+  //! Get a pointer to the beginning of the source text.
+  //! @return pointer to the beginning of the source text
+  const char *get_source() const { return m_src; }
+
+  //! Get the source file's id in the FileTable.
+  //! @return the source file id
+  unsigned get_file_id() const { return m_file_id; }
+
+  //! Add a Token.
+  //! @param tag the token's tag value
+  //! @param offset offset of the lexeme in the source text
+  //! @param len length of the lexeme
+  void add(int tag, unsigned offset, unsigned len) {
+    m_tokens.push_back({ tag, offset, len });
+  }
+
+  //! Get the number of Tokens (including any which were discarded.)
+  //! @return the number of Tokens
+  unsigned get_num_tokens() const { return m_base + unsigned(m_tokens.size()); }
+
+  //! Get the index of the first Token which hasn't been discarded.
+  //! @return the index of the first Token
+  unsigned get_first_token() const { return m_base; }
+
+  //! Get the Token at given index.
+  //! @param index the index of the Token (0 for the first Token, etc.),
+  //!              which must not have been discarded
+  //! @return reference to the Token
+  const Token &get_token(unsigned index) const { return m_tokens[index - m_base]; }
+
+  //! Get the lexeme of the Token at given index.
+  //! @param index the index of the Token (0 for the first Token, etc.),
+  //!              which must not have been discarded
+  //! @return view of the lexeme in the source text
+  std::string_view get_lexeme(unsigned index) const {
+    const Token &tok = get_token(index);
+    return std::string_view(m_src + tok.offset, tok.len);
+  }
+
+  //! Get the source Location of the Token at given index.
+  //! @param index the index of the Token (0 for the first Token, etc.),
+  //!              which must not have been discarded
+  //! @return the source Location of the Token
+  Location get_loc(unsigned index) const {
+    return Location(m_file_id, get_token(index).offset);
+  }
+
+  //! Discard the Tokens preceding a given index, so that the memory
+  //! used for them can be reused for subsequent Tokens.
+  //! @param index the index of the first Token to keep
+  void discard_before(unsigned index);
+
+  //! Get the amount of memory used for the Tokens.
+  //! @return the number of bytes used
+  size_t get_memory_size() const { return m_tokens.capacity() * sizeof(Token); }
+};
+
+#endif // TOKEN_TABLE_H
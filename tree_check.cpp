@@ -0,0 +1,134 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Round-trip check for the binary tree file format (see tree_format.h).
+// Each source file is parsed, and its tree is written to a temporary
+// tree file. The tree file is memory-mapped and compared (using a
+// TreeView) against the in-memory tree, including the line and column
+// of each Node's Location, and is then read back into Nodes, which must
+// serialize to exactly the same bytes.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include "nearly_c.h"
+#include "node_arena.h"
+#include "tree_format.h"
+
+namespace {
+
+// Write data to a new temporary file, and return its name
+std::string write_temp_file(const std::string &data) {
+  char name[] = "/tmp/tree_check.XXXXXX";
+  int fd = mkstemp(name);
+  if (fd < 0) {
+    RuntimeError::raise("Couldn't create temporary file");
+  }
+  FILE *out = fdopen(fd, "wb");
+  bool ok = (fwrite(data.data(), 1, data.size(), out) == data.size());
+  ok = (fclose(out) == 0) && ok;
+  if (!ok) {
+    unlink(name);
+    RuntimeError::raise("Couldn't write temporary file");
+  }
+  return name;
+}
+
+// Check that the line and column of each node in a TreeView are
+// those of the corresponding Node's Location (the trees must
+// already be known to be identical)
+bool locations_match(const TreeView &view, Node *root) {
+  unsigned i = 0;
+  return root->traverse(
+    [&](Node *n, unsigned) {
+      const Location &loc = n->get_loc();
+      if (loc.is_valid() && (view.get_line(i) != loc.get_line() || view.get_col(i) != loc.get_col())) {
+        return TRAVERSE_STOP;
+      }
+      ++i;
+      return TRAVERSE_CONTINUE;
+    },
+    [](Node *, unsigned) {
+      return TRAVERSE_CONTINUE;
+    });
+}
+
+// Check one source file, returning an error message if the
+// check fails, or an empty string if it succeeds
+std::string check_file(Context &ctx, const std::string &filename) {
+  ctx.parse(filename);
+  Node *root = ctx.get_ast();
+
+  std::string data;
+  TreeWriter::write(root, data);
+  std::string tree_filename = write_temp_file(data);
+
+  std::string error;
+  try {
+    TreeFile tree_file(tree_filename);
+    const TreeView &view = tree_file.get_view();
+    if (!TreeReader::equals(view, root)) {
+      error = "tree file doesn't match the parsed tree";
+    } else if (!locations_match(view, root)) {
+      error = "tree file has the wrong line or column for a node";
+    } else {
+      NodeArena arena;
+      Node *copy = TreeReader::read(view, &arena, ctx.get_tokens().get_file_id());
+      std::string copy_data;
+      TreeWriter::write(copy, copy_data);
+      if (copy_data != data) {
+        error = "tree read from the tree file doesn't serialize identically";
+      }
+    }
+  } catch (BaseException &ex) {
+    error = ex.what();
+  }
+  unlink(tree_filename.c_str());
+  return error;
+}
+
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: tree_check <filename>...\n");
+    exit(1);
+  }
+
+  Context ctx;
+  unsigned num_failed = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::string error;
+    try {
+      error = check_file(ctx, argv[i]);
+    } catch (BaseException &ex) {
+      error = ex.what();
+    }
+    if (error.empty()) {
+      printf("%s: ok\n", argv[i]);
+    } else {
+      printf("%s: FAILED: %s\n", argv[i], error.c_str());
+      ++num_failed;
+    }
+  }
+
+  return num_failed > 0 ? 1 : 0;
+}
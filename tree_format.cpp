@@ -0,0 +1,333 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include "node.h"
+#include "file_table.h"
+#include "exceptions.h"
+#include "tree_format.h"
+
+namespace {
+
+template<typename T>
+void append_value(std::string &out, const T &value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+size_t padded(size_t n) {
+  return (n + 3) & ~size_t(3);
+}
+
+}
+
+void TreeWriter::write(Node *root, std::string &out) {
+  // Assign an index in the string table to each distinct
+  // string value, and create the records. (Symbol ids can't be
+  // used to find the distinct strings, since not all strings are
+  // interned, and the Nodes might not all use the same Interner.)
+  // Each source file id is likewise assigned an index in
+  // the file table.
+  std::unordered_map<std::string_view, uint32_t> string_index;
+  std::vector<std::string_view> strings;
+  std::unordered_map<unsigned, uint32_t> file_index;
+  std::vector<TreeFileRecord> files;
+  std::vector<uint32_t> line_starts;
+  std::vector<TreeRecord> records;
+
+  auto get_string_index = [&](std::string_view str) {
+    auto i = string_index.find(str);
+    if (i == string_index.end()) {
+      i = string_index.insert({ str, uint32_t(strings.size()) }).first;
+      strings.push_back(str);
+    }
+    return i->second;
+  };
+
+  auto get_file_index = [&](unsigned file_id) {
+    auto i = file_index.find(file_id);
+    if (i == file_index.end()) {
+      const SourceFile *src = FileTable::get_file(file_id);
+      const std::vector<unsigned> &starts = src->get_line_starts();
+      files.push_back({ get_string_index(src->get_name()), uint32_t(line_starts.size()),
+                        uint32_t(starts.size()) });
+      line_starts.insert(line_starts.end(), starts.begin(), starts.end());
+      i = file_index.insert({ file_id, uint32_t(files.size() - 1) }).first;
+    }
+    return i->second;
+  };
+
+  root->traverse(
+    [&](Node *n, unsigned) {
+      uint32_t str = get_string_index(n->get_str_view());
+      const Location &loc = n->get_loc();
+      records.push_back({ int32_t(n->get_tag()), str,
+                          loc.is_valid() ? get_file_index(loc.get_file_id()) : 0,
+                          loc.is_valid() ? loc.get_offset() : TREE_NO_LOCATION,
+                          n->get_num_kids(), 0,
+                          n->is_loc_set_explicitly() ? TREE_LOC_EXPLICIT : 0 });
+      // the subtree size is temporarily the index of the record
+      records.back().subtree_size = uint32_t(records.size() - 1);
+      return TRAVERSE_CONTINUE;
+    },
+    [&](Node *, unsigned) {
+      return TRAVERSE_CONTINUE;
+    });
+
+  // Compute the subtree sizes: since the records are in preorder,
+  // the subtree of a record ends where the subtree of its
+  // last child ends (scanning backwards, children are done first)
+  for (size_t i = records.size(); i-- > 0; ) {
+    size_t end = i + 1;
+    for (uint32_t k = 0; k < records[i].num_kids; ++k) {
+      end += records[end].subtree_size;
+    }
+    records[i].subtree_size = uint32_t(end - i);
+  }
+
+  TreeFileHeader header;
+  memcpy(header.magic, "NCTF", 4);
+  header.byte_order = TREE_FILE_BYTE_ORDER;
+  header.version = TREE_FILE_VERSION;
+  header.num_strings = uint32_t(strings.size());
+  header.string_bytes = 0;
+  header.num_nodes = uint32_t(records.size());
+  header.num_files = uint32_t(files.size());
+  header.num_line_starts = uint32_t(line_starts.size());
+  for (auto i = strings.begin(); i != strings.end(); ++i) {
+    header.string_bytes += uint32_t(i->size());
+  }
+
+  out.reserve(out.size() + sizeof(header) + 4 * (strings.size() + 1)
+              + padded(header.string_bytes) + files.size() * sizeof(TreeFileRecord)
+              + line_starts.size() * 4 + records.size() * sizeof(TreeRecord));
+  append_value(out, header);
+  uint32_t offset = 0;
+  append_value(out, offset);
+  for (auto i = strings.begin(); i != strings.end(); ++i) {
+    offset += uint32_t(i->size());
+    append_value(out, offset);
+  }
+  for (auto i = strings.begin(); i != strings.end(); ++i) {
+    out.append(i->data(), i->size());
+  }
+  out.append(padded(header.string_bytes) - header.string_bytes, '\0');
+  out.append(reinterpret_cast<const char *>(files.data()), files.size() * sizeof(TreeFileRecord));
+  out.append(reinterpret_cast<const char *>(line_starts.data()), line_starts.size() * 4);
+  out.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(TreeRecord));
+}
+
+TreeView::TreeView(const char *data, size_t size) {
+  TreeFileHeader header;
+  if (size < sizeof(header)) {
+    RuntimeError::raise("Invalid tree file (too short)");
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, "NCTF", 4) != 0 || header.byte_order != TREE_FILE_BYTE_ORDER) {
+    RuntimeError::raise("Invalid tree file (bad header)");
+  }
+  if (header.version != TREE_FILE_VERSION) {
+    RuntimeError::raise("Unsupported tree file version %u", unsigned(header.version));
+  }
+  if (reinterpret_cast<uintptr_t>(data) % 4 != 0) {
+    RuntimeError::raise("Tree file data isn't aligned");
+  }
+
+  size_t offsets_pos = sizeof(header);
+  size_t strings_pos = offsets_pos + 4 * (size_t(header.num_strings) + 1);
+  size_t files_pos = strings_pos + padded(header.string_bytes);
+  size_t line_starts_pos = files_pos + size_t(header.num_files) * sizeof(TreeFileRecord);
+  size_t records_pos = line_starts_pos + 4 * size_t(header.num_line_starts);
+  if (header.num_nodes == 0 || size != records_pos + size_t(header.num_nodes) * sizeof(TreeRecord)) {
+    RuntimeError::raise("Invalid tree file (bad size)");
+  }
+
+  m_num_strings = header.num_strings;
+  m_num_nodes = header.num_nodes;
+  m_num_files = header.num_files;
+  m_string_offsets = reinterpret_cast<const uint32_t *>(data + offsets_pos);
+  m_strings = data + strings_pos;
+  m_files = reinterpret_cast<const TreeFileRecord *>(data + files_pos);
+  m_line_starts = reinterpret_cast<const uint32_t *>(data + line_starts_pos);
+  m_records = reinterpret_cast<const TreeRecord *>(data + records_pos);
+
+  if (m_string_offsets[0] != 0) {
+    RuntimeError::raise("Invalid tree file (bad string table)");
+  }
+  for (uint32_t i = 0; i < m_num_strings; ++i) {
+    if (m_string_offsets[i] > m_string_offsets[i + 1] || m_string_offsets[i + 1] > header.string_bytes) {
+      RuntimeError::raise("Invalid tree file (bad string table)");
+    }
+  }
+
+  // Each file's lines must be in the line table, and begin
+  // at increasing offsets (starting at 0)
+  for (uint32_t f = 0; f < m_num_files; ++f) {
+    const TreeFileRecord &file = m_files[f];
+    if (file.name >= m_num_strings || file.num_lines == 0
+        || file.first_line > header.num_line_starts
+        || file.num_lines > header.num_line_starts - file.first_line
+        || m_line_starts[file.first_line] != 0) {
+      RuntimeError::raise("Invalid tree file (bad file table)");
+    }
+    for (uint32_t k = file.first_line + 1; k < file.first_line + file.num_lines; ++k) {
+      if (m_line_starts[k] <= m_line_starts[k - 1]) {
+        RuntimeError::raise("Invalid tree file (bad file table)");
+      }
+    }
+  }
+
+  // Check that each node's children exactly cover its subtree.
+  // Each node is visited once as a child, so this is linear.
+  if (m_records[0].subtree_size != m_num_nodes) {
+    RuntimeError::raise("Invalid tree file (bad node record)");
+  }
+  for (uint32_t i = 0; i < m_num_nodes; ++i) {
+    const TreeRecord &rec = m_records[i];
+    if (rec.str >= m_num_strings || rec.subtree_size == 0 || rec.subtree_size > m_num_nodes - i
+        || (rec.flags & ~TREE_LOC_EXPLICIT) != 0
+        || (rec.offset != TREE_NO_LOCATION && rec.file >= m_num_files)) {
+      RuntimeError::raise("Invalid tree file (bad node record)");
+    }
+    uint32_t end = i + rec.subtree_size;
+    uint32_t k = i + 1;
+    for (uint32_t n = 0; n < rec.num_kids; ++n) {
+      if (k >= end || m_records[k].subtree_size > end - k) {
+        RuntimeError::raise("Invalid tree file (bad node record)");
+      }
+      k += m_records[k].subtree_size;
+    }
+    if (k != end) {
+      RuntimeError::raise("Invalid tree file (bad node record)");
+    }
+  }
+}
+
+int TreeView::get_line(unsigned i) const {
+  // find the first line starting after the offset:
+  // the line before it is the one containing the offset
+  const TreeFileRecord &file = m_files[m_records[i].file];
+  const uint32_t *begin = m_line_starts + file.first_line;
+  const uint32_t *end = begin + file.num_lines;
+  return int(std::upper_bound(begin, end, m_records[i].offset) - begin);
+}
+
+int TreeView::get_col(unsigned i) const {
+  const TreeFileRecord &file = m_files[m_records[i].file];
+  unsigned line_start = m_line_starts[file.first_line + get_line(i) - 1];
+  return int(m_records[i].offset - line_start) + 1;
+}
+
+namespace {
+
+// Load a tree file into a SourceBuffer, and return a TreeView of it
+TreeView load_tree_file(SourceBuffer &buf, const std::string &filename) {
+  buf.load_file(filename);
+  return TreeView(buf.get_data(), buf.get_size());
+}
+
+}
+
+TreeFile::TreeFile(const std::string &filename)
+  : m_view(load_tree_file(m_buf, filename)) {
+}
+
+Node *TreeReader::read(const char *data, size_t size, NodeArena *arena, unsigned file_id) {
+  return read(TreeView(data, size), arena, file_id);
+}
+
+Node *TreeReader::read(const TreeView &view, NodeArena *arena, unsigned file_id) {
+  // intern the strings (using the arena's Interner, if it has one)
+  Interner *interner = (arena != nullptr) ? arena->get_interner() : nullptr;
+  if (interner == nullptr) {
+    interner = &Interner::get_global();
+  }
+  std::vector<unsigned> syms(view.get_num_strings());
+  for (unsigned i = 0; i < view.get_num_strings(); ++i) {
+    syms[i] = interner->intern(view.get_string(i));
+  }
+
+  // Appending a child can give a Node without a Location the child's
+  // Location, so each Node's Location (or its absence), and whether it
+  // was set explicitly, are restored once its children are appended
+  auto restore_loc = [&](Node *n, unsigned i) {
+    Location loc = view.has_loc(i) ? Location(file_id, view.get_offset(i)) : Location();
+    n->restore_loc(loc, view.is_loc_explicit(i));
+  };
+
+  // Create the Nodes in preorder. The stack contains the Nodes
+  // whose subtrees haven't been completely read yet, along with
+  // each one's index.
+  std::vector<std::pair<Node *, unsigned>> stack;
+  Node *root = nullptr;
+  for (unsigned i = 0; i < view.get_num_nodes(); ++i) {
+    while (!stack.empty() && view.get_subtree_end(stack.back().second) <= i) {
+      restore_loc(stack.back().first, stack.back().second);
+      stack.pop_back();
+    }
+
+    Node *n = new (arena) Node(view.get_tag(i));
+    n->set_sym(syms[view.get_str_index(i)]);
+    if (i == 0) {
+      root = n;
+    } else {
+      stack.back().first->append_kid(n);
+    }
+    if (view.get_num_kids(i) > 0) {
+      stack.push_back({ n, i });
+    } else {
+      restore_loc(n, i);
+    }
+  }
+  while (!stack.empty()) {
+    restore_loc(stack.back().first, stack.back().second);
+    stack.pop_back();
+  }
+
+  return root;
+}
+
+bool TreeReader::equals(const TreeView &view, Node *root) {
+  // Both trees are compared in preorder; since the number of
+  // children of each node is compared, so is their structure
+  unsigned i = 0;
+  bool completed = root->traverse(
+    [&](Node *n, unsigned) {
+      if (i >= view.get_num_nodes()
+          || n->get_tag() != view.get_tag(i)
+          || n->get_str_view() != view.get_str_view(i)
+          || n->get_num_kids() != view.get_num_kids(i)
+          || n->get_loc().is_valid() != view.has_loc(i)
+          || (view.has_loc(i) && n->get_loc().get_offset() != view.get_offset(i))
+          || (view.has_loc(i) && FileTable::get_file(n->get_loc().get_file_id())->get_name() != view.get_srcfile(i))
+          || n->is_loc_set_explicitly() != view.is_loc_explicit(i)) {
+        return TRAVERSE_STOP;
+      }
+      ++i;
+      return TRAVERSE_CONTINUE;
+    },
+    [&](Node *, unsigned) {
+      return TRAVERSE_CONTINUE;
+    });
+  return completed && i == view.get_num_nodes();
+}
@@ -0,0 +1,292 @@
+// Copyright (c) 2021-2023, David H. Hovemeyer <david.hovemeyer@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef TREE_FORMAT_H
+#define TREE_FORMAT_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include "source_buffer.h"
+class Node;
+class NodeArena;
+
+//! @file
+//! A compact binary format for trees (parse trees or ASTs).
+//! A tree file consists of
+//!
+//!   - a header (TreeFileHeader)
+//!   - the string table: `num_strings + 1` 32-bit offsets, followed by
+//!     the string data (string i consists of the bytes from offset i
+//!     to offset i+1), padded to a multiple of 4 bytes
+//!   - the file table: one TreeFileRecord for each source file
+//!     referred to by a Node's Location
+//!   - the line table: `num_line_starts` 32-bit offsets of the line
+//!     beginnings of each source file (see TreeFileRecord)
+//!   - one TreeRecord for each Node, in preorder
+//!
+//! All values are stored in the byte order of the machine that
+//! wrote the file (the header's byte order mark identifies it.)
+//! Everything is aligned on a 4-byte boundary, so a tree file which
+//! is memory-mapped can be accessed in place (see TreeView.)
+//! Locations are stored as a source file (an index in the file table)
+//! and a byte offset. Since the file table contains each source file's
+//! name and line beginnings, the file name, line and column of each
+//! Node can be found without the source file (see TreeView.) When a
+//! tree is read into Nodes, the caller supplies the source file id
+//! for their Locations.
+
+//! Header of a tree file.
+struct TreeFileHeader {
+  char magic[4];          //!< always "NCTF"
+  uint32_t byte_order;    //!< always TREE_FILE_BYTE_ORDER
+  uint32_t version;       //!< TREE_FILE_VERSION
+  uint32_t num_strings;   //!< number of strings in the string table
+  uint32_t string_bytes;  //!< size of the string data (not padded)
+  uint32_t num_nodes;     //!< number of TreeRecords
+  uint32_t num_files;     //!< number of TreeFileRecords
+  uint32_t num_line_starts; //!< number of offsets in the line table
+};
+
+//! Record for one source file in a tree file.
+struct TreeFileRecord {
+  uint32_t name;          //!< index of the file name in the string table
+  uint32_t first_line;    //!< index in the line table of the offset of the first line
+  uint32_t num_lines;     //!< number of lines (always at least 1)
+};
+
+//! Record for one Node in a tree file.
+struct TreeRecord {
+  int32_t tag;            //!< the Node's tag
+  uint32_t str;           //!< index of the Node's string value in the string table
+  uint32_t file;          //!< index of the source file in the file table (0 if no Location)
+  uint32_t offset;        //!< source offset, or TREE_NO_LOCATION
+  uint32_t num_kids;      //!< number of children
+  uint32_t subtree_size;  //!< number of Nodes in the subtree rooted at this Node
+  uint32_t flags;         //!< TREE_LOC_EXPLICIT, or 0
+};
+
+//! Version of the tree file format; it must be changed whenever
+//! the format changes.
+const uint32_t TREE_FILE_VERSION = 3;
+
+//! Value of TreeFileHeader::byte_order.
+const uint32_t TREE_FILE_BYTE_ORDER = 0x01020304;
+
+//! Value of TreeRecord::offset for a Node without a valid Location.
+const uint32_t TREE_NO_LOCATION = 0xFFFFFFFF;
+
+//! Flag in TreeRecord::flags indicating that the Node's Location
+//! was set explicitly (see Node::is_loc_set_explicitly().)
+const uint32_t TREE_LOC_EXPLICIT = 1;
+
+//! Writes trees in the binary tree file format.
+class TreeWriter {
+public:
+  //! Serialize a tree.
+  //! @param root the root of the tree
+  //! @param out the string to which the serialized tree is appended
+  static void write(Node *root, std::string &out);
+};
+
+//! A TreeView provides access to a tree in the binary tree file format
+//! without creating Nodes. As in a FlatTree, nodes are identified by
+//! their index in preorder: the root is node 0, the first child of a
+//! node (if it has any children) immediately follows it, and the subtree
+//! rooted at node `i` consists of the nodes from `i` up to (but not
+//! including) `get_subtree_end(i)`. The data for each node is read
+//! directly from the serialized tree.
+class TreeView {
+private:
+  uint32_t m_num_strings;
+  uint32_t m_num_nodes;
+  uint32_t m_num_files;
+  const uint32_t *m_string_offsets;
+  const char *m_strings;
+  const TreeFileRecord *m_files;
+  const uint32_t *m_line_starts;
+  const TreeRecord *m_records;
+
+public:
+  //! Constructor. The serialized tree must remain valid (and unchanged)
+  //! for as long as the TreeView is used, and must be aligned on a
+  //! 4-byte boundary. Every string index and subtree is checked, so
+  //! the accessors don't need to check anything. Throws RuntimeError
+  //! if the data isn't a valid tree file.
+  //! @param data the serialized tree
+  //! @param size the size of the serialized tree
+  TreeView(const char *data, size_t size);
+
+  //! Get the number of nodes in the tree.
+  //! @return the number of nodes
+  unsigned get_num_nodes() const { return m_num_nodes; }
+
+  //! Get a node's tag.
+  //! @param i index of a node
+  //! @return the node's tag
+  int get_tag(unsigned i) const { return m_records[i].tag; }
+
+  //! Get the number of strings in the string table.
+  //! @return the number of strings
+  unsigned get_num_strings() const { return m_num_strings; }
+
+  //! Get a string from the string table.
+  //! @param s index of the string
+  //! @return view of the string (in the serialized tree)
+  std::string_view get_string(unsigned s) const {
+    return std::string_view(m_strings + m_string_offsets[s],
+                            m_string_offsets[s + 1] - m_string_offsets[s]);
+  }
+
+  //! Get the index of a node's string value in the string table.
+  //! Nodes with the same string value have the same string index.
+  //! @param i index of a node
+  //! @return the index of the node's string value
+  unsigned get_str_index(unsigned i) const { return m_records[i].str; }
+
+  //! Get a node's string value.
+  //! @param i index of a node
+  //! @return view of the node's string value (in the serialized tree)
+  std::string_view get_str_view(unsigned i) const { return get_string(m_records[i].str); }
+
+  //! Check whether a node has a source Location.
+  //! @param i index of a node
+  //! @return true if the node has a source Location
+  bool has_loc(unsigned i) const { return m_records[i].offset != TREE_NO_LOCATION; }
+
+  //! Get the byte offset of a node's source Location.
+  //! @param i index of a node (which must have a source Location)
+  //! @return the byte offset in the source file
+  unsigned get_offset(unsigned i) const { return m_records[i].offset; }
+
+  //! Get the number of source files in the file table.
+  //! @return the number of source files
+  unsigned get_num_files() const { return m_num_files; }
+
+  //! Get the name of a source file in the file table.
+  //! @param f index of the source file
+  //! @return view of the file name (in the serialized tree)
+  std::string_view get_file_name(unsigned f) const { return get_string(m_files[f].name); }
+
+  //! Get the index in the file table of a node's source file.
+  //! @param i index of a node (which must have a source Location)
+  //! @return the index of the source file
+  unsigned get_file(unsigned i) const { return m_records[i].file; }
+
+  //! Get the name of a node's source file.
+  //! @param i index of a node (which must have a source Location)
+  //! @return view of the file name (in the serialized tree)
+  std::string_view get_srcfile(unsigned i) const { return get_file_name(m_records[i].file); }
+
+  //! Get the line number (1 for the first line) of a node's
+  //! source Location.
+  //! @param i index of a node (which must have a source Location)
+  //! @return the line number
+  int get_line(unsigned i) const;
+
+  //! Get the column number (1 for the first column) of a node's
+  //! source Location.
+  //! @param i index of a node (which must have a source Location)
+  //! @return the column number
+  int get_col(unsigned i) const;
+
+  //! Check whether a node's source Location was set explicitly
+  //! (see Node::is_loc_set_explicitly().)
+  //! @param i index of a node
+  //! @return true if the node's source Location was set explicitly
+  bool is_loc_explicit(unsigned i) const { return (m_records[i].flags & TREE_LOC_EXPLICIT) != 0; }
+
+  //! Get the index one past the last node in a node's subtree.
+  //! @param i index of a node
+  //! @return the index one past the last node in the subtree
+  unsigned get_subtree_end(unsigned i) const { return i + m_records[i].subtree_size; }
+
+  //! Get the number of children of a node.
+  //! @param i index of a node
+  //! @return the number of children
+  unsigned get_num_kids(unsigned i) const { return m_records[i].num_kids; }
+
+  //! Invoke a function on the index of each child of a node.
+  //! @tparam Fn function type
+  //! @param i index of the parent node
+  //! @param fn the function to apply to each child's index
+  template<typename Fn>
+  void each_kid(unsigned i, Fn fn) const {
+    unsigned end = get_subtree_end(i);
+    for (unsigned k = i + 1; k < end; k = get_subtree_end(k)) {
+      fn(k);
+    }
+  }
+};
+
+//! A TreeFile is a tree file which is memory-mapped (if possible),
+//! so that it can be accessed using a TreeView without reading
+//! the entire file.
+class TreeFile {
+private:
+  SourceBuffer m_buf;
+  TreeView m_view;
+
+  // copy ctor and assignment operator not allowed
+  TreeFile(const TreeFile &);
+  TreeFile &operator=(const TreeFile &);
+
+public:
+  //! Constructor. Throws RuntimeError if the file can't be read,
+  //! or isn't a valid tree file.
+  //! @param filename the name of the tree file
+  TreeFile(const std::string &filename);
+
+  //! Get the TreeView for accessing the tree.
+  //! @return the TreeView
+  const TreeView &get_view() const { return m_view; }
+};
+
+//! Reads trees in the binary tree file format, creating Nodes.
+class TreeReader {
+public:
+  //! Deserialize a tree. Throws RuntimeError if the data
+  //! isn't a valid tree file.
+  //! @param data the serialized tree
+  //! @param size the size of the serialized tree
+  //! @param arena the arena in which to allocate the Nodes
+  //! @param file_id the source file id for the Nodes' Locations
+  //! @return the root of the tree
+  static Node *read(const char *data, size_t size, NodeArena *arena, unsigned file_id);
+
+  //! Create the Nodes for a tree accessed using a TreeView.
+  //! @param view the TreeView
+  //! @param arena the arena in which to allocate the Nodes
+  //! @param file_id the source file id for the Nodes' Locations
+  //! @return the root of the tree
+  static Node *read(const TreeView &view, NodeArena *arena, unsigned file_id);
+
+  //! Check whether a tree accessed using a TreeView is identical to
+  //! a tree of Nodes (in tags, string values, source file names and
+  //! offsets, and structure.) This is useful for checking that a tree survives
+  //! being written and read back.
+  //! @param view the TreeView
+  //! @param root the root of the tree of Nodes
+  //! @return true if the trees are identical, false if not
+  static bool equals(const TreeView &view, Node *root);
+};
+
+#endif // TREE_FORMAT_H
@@ -19,10 +19,12 @@
 // OTHER DEALINGS IN THE SOFTWARE.
 
 #include <vector>
+#include <unordered_map>
 #include <utility>
 #include <cstdio>
 #include <cassert>
 #include "node.h"
+#include "output_sink.h"
 #include "treeprint.h"
 
 namespace {
@@ -34,13 +36,18 @@ typedef std::pair<int, int> StackItem;
 struct TreePrintContext {
   std::vector<StackItem> stack;
   const TreePrint *tp_obj;
+  OutputSink &out;
+  // tag names, so that node_tag_to_string() is called once per tag
+  std::unordered_map<int, std::string> tag_names;
 
-  TreePrintContext(const TreePrint *tp_obj_)
-    : tp_obj(tp_obj_) { }
+  TreePrintContext(const TreePrint *tp_obj_, OutputSink &out_)
+    : tp_obj(tp_obj_), out(out_) { }
 
   void pushctx(int nsibs);
   void popctx();
+  void print_tree(Node *root);
   void print_node(Node *n);
+  const std::string &get_tag_name(int tag);
 };
 
 void TreePrintContext::pushctx(int nsibs_) {
@@ -51,39 +58,57 @@ void TreePrintContext::popctx() {
   stack.pop_back();
 }
 
+void TreePrintContext::print_tree(Node *root) {
+  pushctx(1);
+  root->traverse(
+    [this](Node *n, unsigned) {
+      print_node(n);
+      pushctx(int(n->get_num_kids()));
+      return TRAVERSE_CONTINUE;
+    },
+    [this](Node *, unsigned) {
+      popctx();
+      return TRAVERSE_CONTINUE;
+    });
+}
+
+// print a single node (but not its children)
 void TreePrintContext::print_node(Node *n) {
   int depth = int(stack.size());
   assert(depth > 0);
   for (int i = 1; i < depth; i++) {
     if (i == depth-1) {
-      printf("+--");
+      out.append("+--");
     } else {
       int level_index = stack[i].first;
       int level_nsibs = stack[i].second;
       if (level_index < level_nsibs) {
-        printf("|  ");
+        out.append("|  ");
       } else {
-        printf("   ");
+        out.append("   ");
       }
     }
   }
 
   int tag = n->get_tag();
-  std::string str = n->get_str();
+  std::string_view str = n->get_str_view();
 
-  printf("%s", tp_obj->node_tag_to_string(tag).c_str());
+  out.append(get_tag_name(tag));
   if (!str.empty()) {
-    printf("[%s]", str.c_str());
+    out.append('[');
+    out.append(str);
+    out.append(']');
   }
-  printf("\n");
+  out.append('\n');
   stack[depth-1].first++;
+}
 
-  int nkids = n->get_num_kids();
-  pushctx(nkids);
-  for (int i = 0; i < nkids; i++) {
-    print_node(n->get_kid(i));
+const std::string &TreePrintContext::get_tag_name(int tag) {
+  auto i = tag_names.find(tag);
+  if (i == tag_names.end()) {
+    i = tag_names.insert({ tag, tp_obj->node_tag_to_string(tag) }).first;
   }
-  popctx();
+  return i->second;
 }
 
 } // end anonymous namespace
@@ -94,8 +119,13 @@ TreePrint::TreePrint() {
 TreePrint::~TreePrint() {
 }
 
-void TreePrint::print(Node *t) const {
-  TreePrintContext ctx(this);
-  ctx.pushctx(1);
-  ctx.print_node(t);
+void TreePrint::print(Node *t, FILE *out) const {
+  OutputSink sink(out);
+  print(t, sink);
+  sink.flush();
+}
+
+void TreePrint::print(Node *t, OutputSink &out) const {
+  TreePrintContext ctx(this, out);
+  ctx.print_tree(t);
 }
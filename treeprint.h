@@ -22,14 +22,20 @@
 #define TREEPRINT_H
 
 #include <string>
+#include <cstdio>
 class Node;
+class OutputSink;
 
 class TreePrint {
 public:
   TreePrint();
   virtual ~TreePrint();
 
-  void print(Node *t) const;
+  // print the tree rooted at t to the given output stream
+  void print(Node *t, FILE *out = stdout) const;
+
+  // print the tree rooted at t to the given OutputSink
+  void print(Node *t, OutputSink &out) const;
 
   virtual std::string node_tag_to_string(int tag) const = 0;
 };
@@ -21,7 +21,6 @@
 #include <cstdarg>
 #include "parser_state.h"
 #include "cpputil.h"
-#include "exceptions.h"
 
 void yyerror(struct ParserState *pp, const char *msg, ...) {
   va_list args;
@@ -29,6 +28,10 @@ void yyerror(struct ParserState *pp, const char *msg, ...) {
   std::string errmsg = cpputil::vformat(msg, args);
   va_end(args);
 
-  throw SyntaxError(pp->cur_loc, errmsg);
+  // The error is recorded rather than thrown, since an exception
+  // would have to pass through the code generated by flex and bison.
+  // Bison recovers from syntax errors using the error productions
+  // in the grammar.
+  pp->diagnostics.add(pp->cur_loc, errmsg);
 }
 
@@ -27,7 +27,8 @@
 #  define YYERROR_PRINTF_FORMAT
 #endif
 
-// Declaration of our yyerror() implementation
+// Declaration of our yyerror() implementation, which records
+// the error in the ParserState's Diagnostics (see diagnostics.h)
 void yyerror(struct ParserState *, const char *, ...) YYERROR_PRINTF_FORMAT;
 
 #endif // YYERROR_H